@@ -11,68 +11,148 @@
 #include <sstream>
 #include <thread>
 #include <chrono>
+#include <string_view>
+#include <memory>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <ctime>
+#include "engine_client.h" // ChessCore UCI 엔진 클라이언트
+#include "engine_session.h" // 탐색 상태/응답 짝짓기
+#include "engine_events.h" // 엔진 -> UI 이벤트 큐 (lock-free, 할당 없음)
+#include "game_clock.h" // 대국 시계
+#include "search_info.h"
+#include "result_cache.h" // 국면별 탐색 결과 캐시 (메모리 매핑 파일)
+#include "game_review.h" // 게임 복기 (국면 분석 순서, 수 분류)
+#include "game_archive.h" // 대국 기록 (바이너리 아카이브)
+#include "opening_tree.h" // 국면별 수 통계 (메모리 매핑 오프닝 트리)
+#ifdef CHESSAI_EMBEDDED_ENGINE
+#include "embedded_engine.h" // 프로세스 내 Stockfish
+#endif
+#include "legal_moves.h" // ChessCore 규칙 라이브러리
+#include "piece_sprites.h" // 미리 디코딩한 기물 이미지
+#include "board_renderer.h" // 바뀐 칸만 다시 그리는 보드 렌더러
+#include "sprite_cache.h" // 칸 크기별 기물 이미지 (워커 스레드에서 생성)
 
 using namespace std;
 using namespace cv;
+using namespace ChessCore;
+
+// ChessMain에 함께 빌드되면 이 파일은 AI 대전 컨트롤러: 전역은 네임스페이스 안에 두고
+// ChessMain이 wWinMain 대신 Run()을 호출 (엔진은 모드 선택 창이 떠 있는 동안 미리 시작)
+#ifdef CHESSMAIN_HOST
+namespace VsAIMode {
+#endif
 
 #define MAX_LOADSTRING 100
 #define BLOCK_COUNT 8
+// 보드는 창 크기에 맞춰 늘고 줄어듦: BLOCK_SIZE는 처음 창의 칸 크기, 지금 칸 크기는 g_blockSize
 #define BLOCK_SIZE 100
-
-// 사용자 정의 메시지: Stockfish 엔진이 움직임을 찾았음을 UI 스레드에 알림
-#define WM_STOCKFISH_MOVE_READY (WM_USER + 1)
+#define MIN_BLOCK_SIZE 24
+#define BOARD_MARGIN 25 // 보드 왼쪽/위 여백
+#define BOARD_PIXELS (g_blockSize * BLOCK_COUNT)
+
+// 사용자 정의 메시지: 엔진 이벤트 큐(g_events)에 처리할 이벤트가 생겼음을 UI 스레드에 알림
+#define WM_ENGINE_EVENTS (WM_USER + 1)
+// 사용자 정의 메시지: 백그라운드 엔진 시작이 끝났음 (wParam: 성공 여부)
+#define WM_ENGINE_READY (WM_USER + 2)
+// 사용자 정의 메시지: 워커 스레드가 새 칸 크기의 기물 이미지를 다 만들었음
+#define WM_SPRITES_READY (WM_USER + 3)
+
+// 시간 제어: 실제 대국 시계를 엔진에 wtime/btime/winc/binc로 넘겨 엔진이 생각할 시간을 정함
+#define CLOCK_BASE_MS (5 * 60 * 1000) // 각자 주어진 시간
+#define CLOCK_INC_MS 2000             // 수마다 더해지는 시간
+#define AI_MOVETIME_MS 0              // 0이 아니면 시계 대신 수당 고정 시간(ms)으로 탐색
+#define CLOCK_TIMER_ID 1
+
+// 엔진 설정
+#define ENGINE_PATH "stockfish\\stockfish-windows-x86-64-avx2.exe" // 외부 프로세스 모드 (path: change if necessary)
+#define ENGINE_HASH_MB 128
+#define STARTUP_LOG_PATH "ChessAI_startup.log"
+
+// 탐색 결과 캐시: 같은 국면을 이 깊이 이상 탐색한 결과가 있으면 탐색 없이 바로 둠.
+// 파일은 세션 사이에 유지되고, 창 제목의 적중률을 보고 크기를 정함
+#define RESULT_CACHE_PATH "ChessAI_results.bin"
+#define RESULT_CACHE_MB 16 // 항목 16바이트: 1MB당 65536 국면
+#define RESULT_CACHE_MIN_DEPTH 18
+
+// 게임 복기 (F5, Esc로 중단): 수순의 모든 국면을 마지막 국면부터 거꾸로 같은 엔진으로 분석.
+// ucinewgame 없이 이어서 탐색하므로 뒤 국면의 깊은 결과가 해시에 남아 앞 국면 탐색에 쓰이고,
+// 국면 하나는 엔진의 모든 스레드가 함께 탐색함
+#define REVIEW_DEPTH 14
+#define REVIEW_REPORT_PATH "ChessAI_review.txt"
+
+// 대국 기록: 끝난 대국과 중간에 그만둔 대국(새 게임, 창 닫기)을 수마다 평가/남은 시간과 함께
+// 추가 전용 바이너리 파일에 저장. Chess2Player와 같은 파일을 쓰고, PGN은 ChessCore의 game_archive 도구로 변환
+#define GAME_ARCHIVE_PATH "ChessGames.bin"
+
+// 탐색 정보 표시: 보드 오른쪽 평가 막대 + 보드 아래 주 변화(PV) 한 줄
+#define INFO_TIMER_ID 2
+#define INFO_FRAME_MS 33 // 약 30fps로 바뀐 정보만 다시 그림
+#define EVAL_BAR_X (BOARD_MARGIN + BOARD_PIXELS + 8)
+#define EVAL_BAR_WIDTH 16
+#define PV_LINE_Y (BOARD_MARGIN + BOARD_PIXELS + 6)
+#define PV_LINE_HEIGHT 20
+
+// 오프닝 트리 패널: 평가 막대 오른쪽에 지금 국면에서 기록된 대국들이 둔 수와 결과/평균 평가 표시.
+// 트리 파일은 ChessCore의 opening_tree 도구로 대국 기록에서 만듦 (opening_tree build ChessGames.bin ChessOpenings.tree)
+#define OPENING_TREE_PATH "ChessOpenings.tree"
+#define OPENING_PANEL_X (EVAL_BAR_X + EVAL_BAR_WIDTH + 8)
+#define OPENING_PANEL_WIDTH 260
+
+// 보드 오른쪽(평가 막대, 오프닝 패널)과 아래(PV 줄)에 필요한 공간
+#define BOARD_RIGHT_SPACE (8 + EVAL_BAR_WIDTH + 8 + OPENING_PANEL_WIDTH + 8)
+#define BOARD_BOTTOM_SPACE (6 + PV_LINE_HEIGHT + 6)
 
 HINSTANCE hInst;
 WCHAR szTitle[MAX_LOADSTRING] = L"Chess Application";
-WCHAR szWindowClass[MAX_LOADSTRING] = L"MyChessWindowClass";
+WCHAR szWindowClass[MAX_LOADSTRING] = L"ChessAIWindowClass";
 
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK About(HWND, UINT, WPARAM, LPARAM);
 
-// -------------------- Blocks and board --------------------
-struct Blocks {
-    RECT rect;
-    string name;
-    BOOL color;
-    int type;
-    Blocks() : rect{ 0,0,0,0 }, name(""), color(FALSE), type(0) {}
-    Blocks& operator=(const Blocks& rhs) {
-        if (this != &rhs) {
-            rect = rhs.rect;
-            name = rhs.name;
-            color = rhs.color;
-            type = rhs.type;
-        }
-        return *this;
-    }
-};
-
-Blocks g_block[BLOCK_COUNT][BLOCK_COUNT];
-string pieceImage[8][8] = {
-    {"rook_black.png","knight_black.png","bishop_black.png","queen_black.png","king_black.png","bishop_black.png","knight_black.png","rook_black.png"},
-    {"pawn_black.png","pawn_black.png","pawn_black.png","pawn_black.png","pawn_black.png","pawn_black.png","pawn_black.png","pawn_black.png"},
-    {"","","","","","","",""},
-    {"","","","","","","",""},
-    {"","","","","","","",""},
-    {"","","","","","","",""},
-    {"pawn_white.png","pawn_white.png","pawn_white.png","pawn_white.png","pawn_white.png","pawn_white.png","pawn_white.png","pawn_white.png"},
-    {"rook_white.png","knight_white.png","bishop_white.png","queen_white.png","king_white.png","bishop_white.png","knight_white.png","rook_white.png"}
-};
+// -------------------- Board --------------------
+// 보드 상태와 규칙은 공용 ChessCore 라이브러리(비트보드)가 관리
+Board g_board;
+MoveList g_legalMoves; // 현재 턴의 합법 수 목록 (턴 시작 시 한 번만 생성)
+MoveListCache g_moveCache; // 최근 국면의 합법 수 목록 캐시 (Zobrist 키 기준)
+
+// 기물 이미지 (한 번만 디코딩/크기 조정해 둔 것. 프레임마다 imread 하지 않음).
+// 다른 칸 크기용은 g_spriteCache가 워커 스레드에서 만들고, 다 될 때까지는 가장 가까운 크기로 그림
+const PieceSprites* g_sprites = nullptr;
+SpriteCache g_spriteCache;
+int g_blockSize = BLOCK_SIZE; // 지금 칸 크기 (픽셀)
 
 bool selected = false;
 int selectedX = -1, selectedY = -1;
-set<pair<int, int>> availableMoves;
-bool isWhiteTurn = true;
-vector<string> moveHistory;
-bool isThinking = false; // AI 계산 중 상태 플래그
-
-// 캐슬링 권한 및 킹/룩 이동 추적
-bool whiteKingMoved = false;
-bool whiteRookH1Moved = false; // 킹사이드 룩 (h1)
-bool whiteRookA1Moved = false; // 퀸사이드 룩 (a1)
-bool blackKingMoved = false;
-bool blackRookH8Moved = false; // 킹사이드 룩 (h8)
-bool blackRookA8Moved = false; // 퀸사이드 룩 (a8)
+Bitboard availableMoves = 0; // 선택된 기물의 합법 도착 칸
+vector<Move> moveHistory; // 시작 국면부터 둔 수 (엔진에 그대로 전달)
+GameClock g_clock; // 대국 시계 (White: 사용자, Black: AI)
+
+// 프리무브: AI 차례에 사용자가 미리 입력해 둔 수 (출발/도착 칸만 기록, 먼저 넣은 것부터).
+// AI 수가 적용되는 즉시 새 국면의 합법 수 목록으로 검사해 맞으면 바로 두고, 틀리면 모두 취소
+vector<Move> g_premoves;
+
+// 게임 복기 상태 (F5)
+GameReview g_review;
+vector<size_t> g_reviewPlies; // 분석할 국면 (분석 순서대로)
+size_t g_reviewNext = 0;
+bool g_reviewing = false;
+chrono::steady_clock::time_point g_reviewStart;
+
+// 진행 중인 대국의 기록 (이름, 시작 시각, 수마다 평가와 남은 시간). 수순은 moveHistory
+ArchivedGame g_game;
+bool g_gameArchived = false; // 이미 저장했으면 창을 닫을 때 다시 저장하지 않음
+
+// 프리무브 입력용 보드: 현재 국면에 대기 중인 프리무브를 (AI 응수 없이) 차례로 적용한 기물 배치.
+// 이어지는 프리무브(예: g1f3 다음 f3g5)의 출발 칸을 고를 때 사용
+void premoveView(Piece view[SQUARE_NB]) {
+    for (int sq = 0; sq < SQUARE_NB; ++sq) view[sq] = g_board.piece_on(Square(sq));
+    for (Move m : g_premoves) {
+        view[m.to_sq()] = view[m.from_sq()];
+        view[m.from_sq()] = NO_PIECE;
+    }
+}
 
 
 // double buffer
@@ -98,584 +178,825 @@ void CleanUpDoubleBuffer() {
     if (hbmBack) { DeleteObject(hbmBack); hbmBack = NULL; }
 }
 
+// board framebuffer: 보드 이미지는 DIB 섹션 하나에 계속 유지. BoardRenderer가 그 픽셀에
+// 바뀐 칸만 직접 그리고, 백버퍼로도 바뀐 칸만 BitBlt (매 페인트마다 Mat 생성/변환 없음)
+BoardRenderer g_renderer;
+HBITMAP g_boardDib = NULL;
+HDC g_boardDC = NULL;
+
+void SetupBoardBuffer(HDC hdc) {
+    int pixels = BOARD_PIXELS;
+    BITMAPINFO bi; ZeroMemory(&bi, sizeof(BITMAPINFO));
+    bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER); bi.bmiHeader.biWidth = pixels; bi.bmiHeader.biHeight = -pixels; // 위에서 아래로
+    bi.bmiHeader.biPlanes = 1; bi.bmiHeader.biBitCount = 24; bi.bmiHeader.biCompression = BI_RGB;
+    void* bits = nullptr;
+    g_boardDib = CreateDIBSection(hdc, &bi, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (!g_boardDib) return;
+    g_boardDC = CreateCompatibleDC(hdc);
+    SelectObject(g_boardDC, g_boardDib);
+    size_t stride = ((size_t)pixels * 3 + 3) & ~(size_t)3; // DIB 행은 4바이트 정렬
+    g_renderer.reset(g_spriteCache.get(g_blockSize), g_blockSize, Mat(pixels, pixels, CV_8UC3, bits, stride));
+}
+void CleanUpBoardBuffer() {
+    if (g_boardDC) { DeleteDC(g_boardDC); g_boardDC = NULL; }
+    if (g_boardDib) { DeleteObject(g_boardDib); g_boardDib = NULL; }
+}
+
 // -------------------- chess logic prototypes --------------------
-void copyBoard(Blocks(&dst)[BLOCK_COUNT][BLOCK_COUNT], Blocks(&src)[BLOCK_COUNT][BLOCK_COUNT]);
-pair<int, int> findKing(bool white, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]);
-set<pair<int, int>> allPieceMoves(int x, int y, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]);
-set<pair<int, int>> getLegalMoves(int x, int y, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]);
-vector<pair<int, int>> checkProtectingPieces(bool isWhiteTurn, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]);
-string boardToFEN(Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT], bool whiteTurn);
-bool isCheck(bool white, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]);
-bool detectCheckmate(bool white, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]);
-void handlePromotion(int x, int y, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]);
-bool applyUCIMoveToBoard(const string& uciMove, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]);
+Square blockToSquare(int x, int y);
+bool detectCheckmate(const Board& board, const MoveList& legalMoves);
+const wchar_t* detectDraw(const Board& board, const MoveList& legalMoves);
 
 // -------------------- chess logic implementations --------------------
-void copyBoard(Blocks(&dst)[BLOCK_COUNT][BLOCK_COUNT], Blocks(&src)[BLOCK_COUNT][BLOCK_COUNT]) {
-    for (int x = 0; x < BLOCK_COUNT; x++) for (int y = 0; y < BLOCK_COUNT; y++) dst[x][y] = src[x][y];
-}
-
-pair<int, int> findKing(bool white, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]) {
-    for (int x = 0; x < BLOCK_COUNT; x++) for (int y = 0; y < BLOCK_COUNT; y++)
-        if (!board[x][y].name.empty() && board[x][y].name.find("king") != string::npos && board[x][y].color == (white ? TRUE : FALSE))
-            return { x, y };
-    return { -1, -1 };
-}
-
-set<pair<int, int>> allPieceMoves(int x, int y, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]) {
-    set<pair<int, int>> moves;
-    if (x < 0 || x >= BLOCK_COUNT || y < 0 || y >= BLOCK_COUNT) return moves;
-    Blocks from = board[x][y];
-    if (from.name.empty()) return moves;
-    bool isWhite = (from.color == TRUE);
-    string name = from.name;
-    int forward = isWhite ? -1 : 1;
-
-    if (name.find("pawn") != string::npos) {
-        int ny = y + forward;
-        if (ny >= 0 && ny < BLOCK_COUNT && board[x][ny].name.empty()) moves.insert({ x, ny });
-        if ((isWhite && y == 6) || (!isWhite && y == 1)) {
-            int ny2 = y + 2 * forward;
-            if (ny2 >= 0 && ny2 < BLOCK_COUNT && board[x][ny].name.empty() && board[x][ny2].name.empty()) moves.insert({ x, ny2 });
-        }
-        for (int dx : { -1, 1 }) {
-            int nx = x + dx;
-            if (nx >= 0 && nx < BLOCK_COUNT && ny >= 0 && ny < BLOCK_COUNT && !board[nx][ny].name.empty() && board[nx][ny].color != from.color)
-                moves.insert({ nx, ny });
-        }
+// 화면 칸 (x = 파일, y = 위에서부터의 행) -> 보드 칸
+Square blockToSquare(int x, int y) {
+    return make_square(File(x), Rank(BLOCK_COUNT - 1 - y));
+}
+
+bool detectCheckmate(const Board& board, const MoveList& legalMoves) {
+    return board.in_check() && legalMoves.empty();
+}
+
+// 무승부 (스테일메이트, 3회 동형 반복, 50수 규칙). 해당 없으면 nullptr
+const wchar_t* detectDraw(const Board& board, const MoveList& legalMoves) {
+    if (!board.in_check() && legalMoves.empty()) return L"Draw (stalemate)";
+    if (board.is_threefold()) return L"Draw (threefold repetition)";
+    if (board.is_fifty_moves()) return L"Draw (50-move rule)";
+    return nullptr;
+}
+
+// -------------------- rendering & utilities --------------------
+// 지금 보여야 할 보드: 기물 배치와 칸별 하이라이트 (프리무브, 선택한 기물, 합법 도착 칸)
+BoardFrame CurrentBoardFrame() {
+    BoardHighlights highlights;
+    for (Move m : g_premoves) highlights.premoves |= square_bb(m.from_sq()) | square_bb(m.to_sq());
+    if (selected) {
+        highlights.selected = blockToSquare(selectedX, selectedY);
+        highlights.targets = availableMoves;
     }
-    else if (name.find("rook") != string::npos) {
-        int dirs[4][2] = { {1,0},{-1,0},{0,1},{0,-1} };
-        for (auto& d : dirs) {
-            for (int s = 1; s < BLOCK_COUNT; ++s) {
-                int nx = x + d[0] * s, ny = y + d[1] * s;
-                if (nx < 0 || nx >= BLOCK_COUNT || ny < 0 || ny >= BLOCK_COUNT) break;
-                if (board[nx][ny].name.empty()) moves.insert({ nx, ny });
-                else { if (board[nx][ny].color != from.color) moves.insert({ nx, ny }); break; }
-            }
-        }
+    return make_frame(g_board, highlights);
+}
+
+// 보드 칸의 창 좌표
+RECT SquareClientRect(Square s) {
+    Rect r = g_renderer.square_rect(s);
+    return { BOARD_MARGIN + r.x, BOARD_MARGIN + r.y, BOARD_MARGIN + r.x + r.width, BOARD_MARGIN + r.y + r.height };
+}
+
+pair<int, int> pointToBlock(POINT pt) {
+    // 보드는 (BOARD_MARGIN, BOARD_MARGIN)에서 시작하고 칸 크기는 창 크기를 따라감
+    if (pt.x < BOARD_MARGIN || pt.y < BOARD_MARGIN) return { -1, -1 };
+    int x = (pt.x - BOARD_MARGIN) / g_blockSize, y = (pt.y - BOARD_MARGIN) / g_blockSize;
+    if (x >= BLOCK_COUNT || y >= BLOCK_COUNT) return { -1, -1 };
+    return { x, y };
+}
+
+// -------------------- Search info (eval bar / PV) --------------------
+// info는 엔진 이벤트 큐로 도착해 MultiPV 줄마다 최신 값만 g_searchLines에 남음.
+// 그리기는 INFO_TIMER_ID 프레임마다 바뀐 것이 있을 때만 하므로,
+// 엔진이 info를 아무리 빨리 내보내도 보드 전체를 다시 그리지 않음
+SearchInfoLines g_searchLines;
+bool g_searchInfoDirty = false;
+Color g_searchSide = WHITE; // 탐색 국면의 차례 (info 점수의 기준)
+
+void ClearSearchInfo() {
+    g_searchLines.clear();
+    g_searchInfoDirty = true;
+}
+
+RECT EvalBarRect() { return { EVAL_BAR_X, BOARD_MARGIN, EVAL_BAR_X + EVAL_BAR_WIDTH, BOARD_MARGIN + BOARD_PIXELS }; }
+RECT PVLineRect() { return { BOARD_MARGIN, PV_LINE_Y, EVAL_BAR_X + EVAL_BAR_WIDTH, PV_LINE_Y + PV_LINE_HEIGHT }; }
+
+// -------------------- Opening tree panel --------------------
+OpeningTree g_openingTree;
+Key g_openingKey = 0; // g_openingMoves를 찾은 국면
+vector<OpeningTree::Entry> g_openingMoves;
+
+RECT OpeningPanelRect() { return { OPENING_PANEL_X, BOARD_MARGIN, OPENING_PANEL_X + OPENING_PANEL_WIDTH, BOARD_MARGIN + BOARD_PIXELS }; }
+
+// 국면이 바뀌었을 때만 트리를 조회 (이진 탐색 한 번)하고 많이 둔 수부터 한 줄씩 그림
+void DrawOpeningPanel(HDC dc) {
+    RECT panel = OpeningPanelRect();
+    FillRect(dc, &panel, (HBRUSH)(COLOR_WINDOW + 1));
+    SetBkMode(dc, TRANSPARENT);
+    SetTextColor(dc, RGB(0, 0, 0));
+
+    char text[96];
+    if (!g_openingTree.is_open()) {
+        snprintf(text, sizeof(text), "no opening tree (%s)", OPENING_TREE_PATH);
+        TextOutA(dc, panel.left, panel.top, text, (int)strlen(text));
+        return;
     }
-    else if (name.find("knight") != string::npos) {
-        int c[8][2] = { {1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2} };
-        for (auto& co : c) {
-            int nx = x + co[0], ny = y + co[1];
-            if (nx >= 0 && nx < BLOCK_COUNT && ny >= 0 && ny < BLOCK_COUNT && (board[nx][ny].name.empty() || board[nx][ny].color != from.color))
-                moves.insert({ nx, ny });
-        }
+    if (g_board.key() != g_openingKey) {
+        g_openingKey = g_board.key();
+        g_openingTree.lookup(g_openingKey, g_openingMoves);
     }
-    else if (name.find("bishop") != string::npos) {
-        int dirs[4][2] = { {1,1},{1,-1},{-1,1},{-1,-1} };
-        for (auto& d : dirs) {
-            for (int s = 1; s < BLOCK_COUNT; ++s) {
-                int nx = x + d[0] * s, ny = y + d[1] * s;
-                if (nx < 0 || nx >= BLOCK_COUNT || ny < 0 || ny >= BLOCK_COUNT) break;
-                if (board[nx][ny].name.empty()) moves.insert({ nx, ny });
-                else { if (board[nx][ny].color != from.color) moves.insert({ nx, ny }); break; }
-            }
-        }
+
+    snprintf(text, sizeof(text), "tree: %llu games, %zu moves here", (unsigned long long)g_openingTree.games(), g_openingMoves.size());
+    TextOutA(dc, panel.left, panel.top, text, (int)strlen(text));
+    const char* columns = "move    games   W / D / B %   eval";
+    TextOutA(dc, panel.left, panel.top + PV_LINE_HEIGHT, columns, (int)strlen(columns));
+
+    int y = panel.top + 2 * PV_LINE_HEIGHT;
+    for (const OpeningTree::Entry& e : g_openingMoves) {
+        if (y + PV_LINE_HEIGHT > panel.bottom) break;
+        unsigned finished = max(1u, e.whiteWins + e.draws + e.blackWins);
+        char eval[16] = "-";
+        if (e.avgEval != ArchivedGame::NO_EVAL) snprintf(eval, sizeof(eval), "%+.2f", e.avgEval / 100.0);
+        snprintf(text, sizeof(text), "%-6s %6u  %3u/%3u/%3u  %s", Board::uci(Move(e.move)).c_str(), e.games,
+            e.whiteWins * 100 / finished, e.draws * 100 / finished, e.blackWins * 100 / finished, eval);
+        TextOutA(dc, panel.left, y, text, (int)strlen(text));
+        y += PV_LINE_HEIGHT;
     }
-    else if (name.find("queen") != string::npos) {
-        int dirs[8][2] = { {1,0},{-1,0},{0,1},{0,-1},{1,1},{1,-1},{-1,1},{-1,-1} };
-        for (auto& d : dirs) {
-            for (int s = 1; s < BLOCK_COUNT; ++s) {
-                int nx = x + d[0] * s, ny = y + d[1] * s;
-                if (nx < 0 || nx >= BLOCK_COUNT || ny < 0 || ny >= BLOCK_COUNT) break;
-                if (board[nx][ny].name.empty()) moves.insert({ nx, ny });
-                else { if (board[nx][ny].color != from.color) moves.insert({ nx, ny }); break; }
-            }
+}
+
+// 최신 MultiPV 1번 줄을 평가 막대와 PV 한 줄로 그림 (점수는 White 기준)
+void DrawSearchInfo(HDC dc) {
+    RECT bar = EvalBarRect(), pvRect = PVLineRect();
+    FillRect(dc, &pvRect, (HBRUSH)(COLOR_WINDOW + 1));
+
+    // 정보가 없으면 막대는 반반
+    double whiteShare = 0.5;
+    char text[SearchInfoRecord::MAX_PV_CHARS + 64] = "";
+    if (g_searchLines.count > 0) {
+        const SearchInfoRecord& line = g_searchLines.lines[0];
+        const SearchInfo& info = line.info;
+        int score = g_searchSide == WHITE ? info.score : -info.score;
+        char scoreText[16];
+        if (info.isMate) {
+            whiteShare = score > 0 ? 1.0 : 0.0;
+            snprintf(scoreText, sizeof(scoreText), "#%d", score);
         }
-    }
-    else if (name.find("king") != string::npos) {
-        int dirs[8][2] = { {1,0},{-1,0},{0,1},{0,-1},{1,1},{1,-1},{-1,1},{-1,-1} };
-        for (auto& d : dirs) {
-            int nx = x + d[0], ny = y + d[1];
-            if (nx >= 0 && nx < BLOCK_COUNT && ny >= 0 && ny < BLOCK_COUNT && (board[nx][ny].name.empty() || board[nx][ny].color != from.color))
-                moves.insert({ nx, ny });
+        else {
+            whiteShare = 1.0 / (1.0 + exp(-score / 400.0)); // 폰 4개 차이면 약 73%
+            snprintf(scoreText, sizeof(scoreText), "%+.2f", score / 100.0);
         }
+        // 복기 중이면 진행 상황을 앞에 표시
+        int len = g_reviewing ? snprintf(text, sizeof(text), "review %zu/%zu  ", g_reviewNext + 1, g_reviewPlies.size()) : 0;
+        snprintf(text + len, sizeof(text) - len, "d%d  %s  %.*s", info.depth, scoreText, (int)line.pv().size(), line.pv().data());
+    }
 
-        // --- 캐슬링 로직 추가 (pseudo-legal moves) ---
-        int startRank = isWhite ? 7 : 0;
-        if (y == startRank && x == 4) { // 킹의 초기 위치 (e1 또는 e8)
+    // 아래(White 쪽)부터 White 몫만큼 채움
+    int whiteTop = bar.bottom - (int)((bar.bottom - bar.top) * whiteShare);
+    RECT blackPart = { bar.left, bar.top, bar.right, whiteTop };
+    RECT whitePart = { bar.left, whiteTop, bar.right, bar.bottom };
+    HBRUSH blackBrush = CreateSolidBrush(RGB(60, 60, 60));
+    HBRUSH whiteBrush = CreateSolidBrush(RGB(240, 240, 240));
+    FillRect(dc, &blackPart, blackBrush);
+    FillRect(dc, &whitePart, whiteBrush);
+    DeleteObject(blackBrush);
+    DeleteObject(whiteBrush);
+
+    SetBkMode(dc, TRANSPARENT);
+    SetTextColor(dc, RGB(0, 0, 0));
+    TextOutA(dc, pvRect.left, pvRect.top, text, (int)strlen(text));
+}
 
-            // 킹사이드 캐슬링 (O-O)
-            if (isWhite ? !whiteKingMoved && !whiteRookH1Moved : !blackKingMoved && !blackRookH8Moved) {
-                if (board[5][startRank].name.empty() && board[6][startRank].name.empty()) {
-                    // 공격받는 칸 체크는 getLegalMoves에서 수행됨
-                    moves.insert({ 6, startRank }); // g1 또는 g8
-                }
-            }
+// 프레임 타이머: 바뀐 정보가 있으면 백버퍼에 그리고 해당 영역만 화면에 복사
+void RefreshSearchInfo(HWND hWnd) {
+    if (!hdcBack || !g_searchInfoDirty) return;
+    g_searchInfoDirty = false;
+    DrawSearchInfo(hdcBack);
+    HDC hdc = GetDC(hWnd);
+    for (RECT r : { EvalBarRect(), PVLineRect() })
+        BitBlt(hdc, r.left, r.top, r.right - r.left, r.bottom - r.top, hdcBack, r.left, r.top, SRCCOPY);
+    ReleaseDC(hWnd, hdc);
+}
 
-            // 퀸사이드 캐슬링 (O-O-O)
-            if (isWhite ? !whiteKingMoved && !whiteRookA1Moved : !blackKingMoved && !blackRookA8Moved) {
-                if (board[1][startRank].name.empty() && board[2][startRank].name.empty() && board[3][startRank].name.empty()) {
-                    // 공격받는 칸 체크는 getLegalMoves에서 수행됨
-                    moves.insert({ 2, startRank }); // c1 또는 c8
-                }
-            }
-        }
-        // ------------------------------------------
+// 바뀐 칸만 프레임버퍼에 다시 그리고 백버퍼로 옮김. 옮긴 칸들을 돌려줌
+Bitboard UpdateBoardLayer() {
+    if (!g_boardDC || !hdcBack) return 0;
+    GdiFlush(); // 앞서 큐에 쌓인 BitBlt가 DIB를 다 읽은 뒤에 픽셀을 씀
+    Bitboard dirty = g_renderer.update(CurrentBoardFrame());
+    for (Bitboard b = dirty; b; ) {
+        Rect r = g_renderer.square_rect(pop_lsb(b));
+        BitBlt(hdcBack, BOARD_MARGIN + r.x, BOARD_MARGIN + r.y, r.width, r.height, g_boardDC, r.x, r.y, SRCCOPY);
     }
-    return moves;
+    return dirty;
 }
 
-bool isCheck(bool white, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]) {
-    auto kingPos = findKing(white, board);
-    if (kingPos.first < 0) return true; // 킹이 없으면 (캡처된 경우 등) 체크된 것으로 간주
+// 보드 상태(기물, 선택, 프리무브)가 바뀐 뒤 호출: 바뀐 칸만 다시 그리고 그 칸만 무효화.
+// 기물 선택이면 선택한 칸과 도착 칸 몇 개만 그려지고 화면에 복사됨
+void InvalidateBoard(HWND hWnd) {
+    if (!hdcBack || !g_boardDC) { InvalidateRect(hWnd, NULL, FALSE); return; } // 첫 WM_PAINT가 전부 그림
+    for (Bitboard b = UpdateBoardLayer(); b; ) {
+        RECT r = SquareClientRect(pop_lsb(b));
+        InvalidateRect(hWnd, &r, FALSE);
+    }
+    if (g_openingTree.is_open() && g_board.key() != g_openingKey) {
+        RECT panel = OpeningPanelRect();
+        InvalidateRect(hWnd, &panel, FALSE);
+    }
+}
 
-    // 킹이 공격받는지 확인하기 위해 상대방 기물들의 이동 가능 칸 확인
-    for (int x = 0; x < BLOCK_COUNT; x++) for (int y = 0; y < BLOCK_COUNT; y++)
-        if (!board[x][y].name.empty() && board[x][y].color != (white ? TRUE : FALSE)) {
-            // allPieceMoves 사용 (킹 보호 로직 제외한 기본 이동)
-            auto mv = allPieceMoves(x, y, board);
-            if (mv.find(kingPos) != mv.end()) return true;
-        }
-    return false;
+// 창 크기에 맞춰 칸 크기를 정함. 바뀌면 보드 프레임버퍼는 다음 WM_PAINT에서 새 크기로 다시 만들고,
+// 기물은 그 크기의 이미지가 워커 스레드에서 만들어질 때까지 가장 가까운 캐시 크기를 늘이거나 줄여 그림
+// (UI 스레드에서는 원본 PNG를 다시 크기 조정하지 않음)
+void FitBoardToWindow(HWND hWnd) {
+    RECT rc; GetClientRect(hWnd, &rc);
+    int fit = min(rc.right - BOARD_MARGIN - BOARD_RIGHT_SPACE, rc.bottom - BOARD_MARGIN - BOARD_BOTTOM_SPACE) / BLOCK_COUNT;
+    int size = max(fit, MIN_BLOCK_SIZE);
+    if (size == g_blockSize) return;
+    g_blockSize = size;
+    CleanUpBoardBuffer();
 }
 
-set<pair<int, int>> getLegalMoves(int x, int y, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]) {
-    set<pair<int, int>> moves;
-    set<pair<int, int>> src = allPieceMoves(x, y, board);
-    bool who = board[x][y].color == TRUE;
-    string pieceName = board[x][y].name;
+// 새 칸 크기의 기물 이미지가 준비됐으면 그것으로 보드 전체를 다시 그림
+void UpdateBoardSprites(HWND hWnd) {
+    if (!g_boardDC) return; // 다음 WM_PAINT가 프레임버퍼를 만들 때 가져감
+    g_renderer.set_sprites(g_spriteCache.get(g_blockSize));
+    InvalidateBoard(hWnd);
+}
 
-    for (auto& dest : src) {
-        Blocks tmp[BLOCK_COUNT][BLOCK_COUNT];
-        copyBoard(tmp, board);
+// 백버퍼를 새로 만들었을 때만 보드 전체를 다시 그리고, 화면에는 무효화된 영역만 복사
+void DrawBoardOnBackBuffer(HDC hdc, HWND hWnd, const RECT& paint) {
+    RECT rc; GetClientRect(hWnd, &rc);
+    int width = rc.right - rc.left, height = rc.bottom - rc.top;
+    if (hdcBack == NULL || hbmBack == NULL || bufferWidth != width || bufferHeight != height) {
+        SetupDoubleBuffer(hdc, hWnd);
+        g_renderer.invalidate();
+    }
+    if (!g_boardDC) SetupBoardBuffer(hdc);
+    UpdateBoardLayer();
+    DrawSearchInfo(hdcBack);
+    DrawOpeningPanel(hdcBack);
+    BitBlt(hdc, paint.left, paint.top, paint.right - paint.left, paint.bottom - paint.top, hdcBack, paint.left, paint.top, SRCCOPY);
+}
+
+// -------------------- Stockfish integration --------------------
+// 엔진 모드 두 가지:
+//  - 내장 모드 (CHESSAI_EMBEDDED_ENGINE): stockfish/src를 함께 빌드하여 같은 프로세스에서
+//    Stockfish::Engine을 직접 호출. 수는 Move 값으로 주고받고 신경망은 한 번만 로드됨.
+//    신경망 파일(.nnue)이 실행 파일 옆에 있어야 하며, 없으면 외부 프로세스 모드로 전환
+//  - 외부 프로세스 모드: EngineClient가 stockfish exe를 실행하고 리더 스레드가
+//    파이프 출력을 한 줄씩 콜백으로 넘겨줌 (폴링/슬립 없음)
+EngineClient g_engine;
+#ifdef CHESSAI_EMBEDDED_ENGINE
+unique_ptr<EmbeddedEngine> g_embedded; // null이면 외부 프로세스 사용
+#endif
+atomic<HWND> g_hMainWnd{ NULL }; // 엔진 이벤트를 받을 창 (엔진 스레드도 읽음)
+
+// 엔진 스레드 -> UI 스레드: 고정 크기 레코드의 SPSC 링 버퍼. 엔진 스레드는 메시지마다
+// new string을 만드는 대신 레코드를 채우고, 큐가 비어 있다가 채워질 때만 WM_ENGINE_EVENTS를
+// 한 번 보냄 (창이 이미 없어져도 샐 메모리가 없음)
+EngineEventQueue g_events;
+
+// 탐색 상태 (IDLE / SEARCHING / PONDERING / STOPPING). 탐색마다 번호를 매기고 bestmove도
+// 도착 순서대로 번호를 매겨, 버린 탐색(무르기, 새 게임, 틀린 폰더 예상)의 응답은 번호로 걸러냄.
+// 그래서 버릴 탐색은 stop만 보내고 결과를 기다리지 않음
+EngineSession g_session;
+
+ResultCache g_resultCache;
+
+// 폰더링: 엔진이 수를 둔 뒤, 엔진이 예상한 사용자 응수 이후 국면을 사용자 차례 동안 미리 탐색
+Move g_ponderMove = Move::none(); // 폰더링 중인 예상 응수 (없으면 none)
+
+// 엔진 결과를 UI 스레드로 넘김 (탐색 번호와 함께)
+// 엔진 스레드에서 호출되므로 칸/승격 정보만 넘기고, 합법 수 목록과의 대조는 UI 스레드에서 함
+void PostBestMove(Move best, Move ponder) {
+    g_events.push_best_move(g_session.next_reply_id(), best, ponder);
+}
 
-        // 이동 적용 (임시 보드)
-        tmp[dest.first][dest.second] = tmp[x][y];
-        tmp[x][y].name = ""; tmp[x][y].color = FALSE;
+void PostInfo(const SearchInfo& info) {
+    g_events.push_info(g_session.pending_reply_id(), info);
+}
 
-        // 캐슬링: 킹의 2칸 이동 (e1->g1, e1->c1, e8->g8, e8->c8)
-        bool isCastling = (pieceName.find("king") != string::npos && abs(x - dest.first) == 2);
+// -------------------- Startup log --------------------
+// 프로그램 시작부터의 경과 시간과 함께 시작 단계를 STARTUP_LOG_PATH에 기록
+// (창이 조작 가능해진 시점과 엔진 준비 시점 비교용). UI/엔진 시작 스레드 양쪽에서 호출
+chrono::steady_clock::time_point g_startTime = chrono::steady_clock::now();
+mutex g_startupLogMutex;
+ofstream g_startupLog;
+
+void StartupLog(const string& msg) {
+    lock_guard<mutex> lock(g_startupLogMutex);
+    if (!g_startupLog.is_open()) g_startupLog.open(STARTUP_LOG_PATH);
+    long long ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - g_startTime).count();
+    g_startupLog << "[" << ms << " ms] " << msg << endl;
+}
 
-        if (isCastling) {
-            int rank = dest.second;
-            // 킹사이드 캐슬링 (e1->g1 또는 e8->g8)
-            if (dest.first == 6) {
-                // 룩 이동 (h1->f1 또는 h8->f8)
-                tmp[5][rank] = tmp[7][rank];
-                tmp[7][rank].name = ""; tmp[7][rank].color = FALSE;
-            }
-            // 퀸사이드 캐슬링 (e1->c1 또는 e8->c8)
-            else if (dest.first == 2) {
-                // 룩 이동 (a1->d1 또는 a8->d8)
-                tmp[3][rank] = tmp[0][rank];
-                tmp[0][rank].name = ""; tmp[0][rank].color = FALSE;
-            }
+// 엔진 탐색 스레드 수: 코어 하나는 UI에 남김
+int EngineThreads() {
+    return max(1, (int)thread::hardware_concurrency() - 1);
+}
 
-            // 캐슬링 특수 규칙: 킹의 원래 칸, 통과하는 칸, 도착하는 칸이 공격받지 않아야 함
-            bool pathAttacked = false;
-            // 통과하는 칸 (킹사이드: f열 / 퀸사이드: d열)
-            int passFile = (dest.first == 6) ? 5 : 3;
-            // 도착하는 칸 (g열 / c열)
-            int destFile = dest.first;
-
-            // 1. 현재 체크 상태가 아닌지
-            if (isCheck(who, board)) { pathAttacked = true; }
-            // 2. 킹이 통과하는 칸이 공격받는지 (e1->g1: f1 체크 / e1->c1: d1 체크)
-            if (!pathAttacked) {
-                Blocks checkTmp[BLOCK_COUNT][BLOCK_COUNT]; copyBoard(checkTmp, board);
-                checkTmp[passFile][rank] = checkTmp[x][y]; // 킹을 통과하는 칸으로 임시 이동
-                checkTmp[x][y].name = ""; checkTmp[x][y].color = FALSE;
-                if (isCheck(who, checkTmp)) { pathAttacked = true; }
-            }
-            // 3. 킹이 도착하는 칸이 공격받는지 (g1 체크 / c1 체크)
-            if (!pathAttacked) {
-                Blocks checkTmp[BLOCK_COUNT][BLOCK_COUNT]; copyBoard(checkTmp, board);
-                checkTmp[destFile][rank] = checkTmp[x][y]; // 킹을 도착하는 칸으로 임시 이동
-                checkTmp[x][y].name = ""; checkTmp[x][y].color = FALSE;
-                if (isCheck(who, checkTmp)) { pathAttacked = true; }
-            }
+// UCI 수 문자열 -> 출발/도착 칸과 승격 기물만 담은 Move ("(none)" 등은 Move::none())
+Move uciToSquares(string_view s) {
+    if (s.size() < 4 || s[0] < 'a' || s[0] > 'h' || s[1] < '1' || s[1] > '8'
+        || s[2] < 'a' || s[2] > 'h' || s[3] < '1' || s[3] > '8')
+        return Move::none();
+    Square from = make_square(File(s[0] - 'a'), Rank(s[1] - '1'));
+    Square to = make_square(File(s[2] - 'a'), Rank(s[3] - '1'));
+    if (s.size() < 5) return Move(from, to);
+    PieceType pt = s[4] == 'n' ? KNIGHT : s[4] == 'b' ? BISHOP : s[4] == 'r' ? ROOK : QUEEN;
+    return Move::make<PROMOTION>(from, to, pt);
+}
 
-            if (pathAttacked) {
-                continue; // 공격받는 길목이 있으면 이 캐슬링은 불가능
-            }
-        }
+// 엔진이 보낸 수를 현재 국면의 합법 수로 변환 (캐슬링/앙파상 구분 포함)
+Move resolveEngineMove(Move m, const MoveList& legalMoves) {
+    if (!m) return Move::none();
+    return legalMoves.find(m.from_sq(), m.to_sq(), m.type_of() == PROMOTION ? m.promotion_type() : QUEEN);
+}
 
-        // 이동 후에도 킹이 체크 상태가 아닌지 확인
-        if (!isCheck(who, tmp)) moves.insert(dest);
+// "bestmove e2e4 ponder e7e5" -> 두 번째, 네 번째 토큰
+void parseBestMove(string_view line, Move& best, Move& ponder) {
+    string_view tokens[4];
+    int n = 0;
+    while (n < 4 && !line.empty()) {
+        size_t end = line.find(' ');
+        tokens[n++] = line.substr(0, end);
+        line = end == string_view::npos ? string_view() : line.substr(end + 1);
     }
-    return moves;
+    best = n >= 2 ? uciToSquares(tokens[1]) : Move::none();
+    ponder = n >= 4 && tokens[2] == "ponder" ? uciToSquares(tokens[3]) : Move::none();
 }
 
-
-vector<pair<int, int>> checkProtectingPieces(bool isWhiteTurn, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]) {
-    vector<pair<int, int>> result;
-    for (int x = 0; x < BLOCK_COUNT; x++) for (int y = 0; y < BLOCK_COUNT; y++)
-        if (!board[x][y].name.empty() && board[x][y].color == (isWhiteTurn ? TRUE : FALSE)) {
-            set<pair<int, int>> ms = getLegalMoves(x, y, board);
-            if (!ms.empty()) result.push_back({ x,y });
-        }
-    return result;
+bool LaunchStockfish(const string& path) {
+    EngineClient::Handlers handlers;
+    handlers.onBestMove = [](string_view line) { // 리더 스레드에서 호출
+        Move best, ponder;
+        parseBestMove(line, best, ponder);
+        PostBestMove(best, ponder);
+    };
+    handlers.onInfo = [](string_view line) {
+        SearchInfo info;
+        if (parse_info(line, info)) PostInfo(info);
+    };
+    if (!g_engine.start(path, handlers)) return false;
+    StartupLog("engine process started");
+
+    // Stockfish 초기 설정 (백그라운드 스레드에서 실행되므로 블로킹해도 무방)
+    // isready는 앞의 setoption(해시 할당 포함)과 신경망 로드가 끝나야 응답함
+    g_engine.send("uci");
+    g_engine.send("setoption name Threads value " + to_string(EngineThreads()));
+    g_engine.send("setoption name Hash value " + to_string(ENGINE_HASH_MB));
+    g_engine.send("setoption name Ponder value true");
+    return g_engine.wait_ready(30000);
 }
 
-bool detectCheckmate(bool white, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]) {
-    if (!isCheck(white, board)) return false;
-    for (int x = 0; x < BLOCK_COUNT; x++) for (int y = 0; y < BLOCK_COUNT; y++)
-        if (!board[x][y].name.empty() && board[x][y].color == (white ? TRUE : FALSE)) {
-            auto moves = getLegalMoves(x, y, board);
-            if (!moves.empty()) return false;
-        }
+#ifdef CHESSAI_EMBEDDED_ENGINE
+bool StartEmbeddedEngine() {
+    char exePath[MAX_PATH];
+    GetModuleFileNameA(NULL, exePath, MAX_PATH);
+    if (!EmbeddedEngine::networks_available(exePath)) return false;
+
+    EmbeddedEngine::Handlers handlers;
+    handlers.onBestMove = [](Move best, Move ponder) { PostBestMove(best, ponder); }; // Stockfish 탐색 스레드에서 호출
+    handlers.onInfo = [](const SearchInfo& info) { PostInfo(info); };
+    g_embedded = make_unique<EmbeddedEngine>(exePath, handlers); // 신경망 로드 포함
+    StartupLog("embedded engine created, networks loaded");
+    g_embedded->set_option("Threads", to_string(EngineThreads()));
+    g_embedded->set_option("Hash", to_string(ENGINE_HASH_MB));
+    g_embedded->set_option("Ponder", "true");
     return true;
 }
+#endif
+
+// 엔진 시작 (실행, 핸드셰이크, 옵션 설정, 신경망 로드)은 백그라운드 작업에서 하고,
+// 창은 바로 조작 가능. 준비되기 전에 들어온 AI 수 요청은 g_aiMovePending에 남겨 두었다가
+// WM_ENGINE_READY에서 처리 (UI 스레드는 기다리지 않음)
+shared_future<bool> g_engineReady;
+bool g_aiMovePending = false;
+bool g_engineErrorShown = false;
+
+bool StartEngine() {
+#ifdef CHESSAI_EMBEDDED_ENGINE
+    // 신경망 파일이 있으면 내장 엔진 사용, 없으면 외부 exe 실행
+    if (StartEmbeddedEngine()) return true;
+#endif
+    return LaunchStockfish(ENGINE_PATH);
+}
 
-// -------------------- rendering & utilities --------------------
-Mat createBoardImage() {
-    Mat boardMat(BLOCK_SIZE * BLOCK_COUNT, BLOCK_SIZE * BLOCK_COUNT, CV_8UC3);
-    Scalar lightColor(175, 223, 240);
-    Scalar darkColor(99, 136, 181);
-    for (int row = 0; row < BLOCK_COUNT; ++row) for (int col = 0; col < BLOCK_COUNT; ++col) {
-        Rect block(col * BLOCK_SIZE, row * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE);
-        bool isLight = ((row + col) % 2 == 0);
-        rectangle(boardMat, block, isLight ? lightColor : darkColor, FILLED);
-        rectangle(boardMat, block, Scalar(0, 0, 0), 1);
-    }
-    for (int row = 0; row < BLOCK_COUNT; ++row) for (int col = 0; col < BLOCK_COUNT; ++col) {
-        string imgPath = g_block[col][row].name;
-        if (imgPath.empty()) continue;
-        Mat piece = imread(imgPath, IMREAD_UNCHANGED);
-        if (piece.empty()) continue;
-        Mat resizedPiece;
-        resize(piece, resizedPiece, Size(BLOCK_SIZE, BLOCK_SIZE), 0, 0, INTER_CUBIC);
-        if (resizedPiece.channels() == 4) {
-            vector<Mat> channels; split(resizedPiece, channels);
-            Mat rgb; merge(vector<Mat>{ channels[0], channels[1], channels[2] }, rgb);
-            Mat alpha = channels[3];
-            Rect roi(col * BLOCK_SIZE, row * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE);
-            Mat boardROI = boardMat(roi);
-            rgb.copyTo(boardROI, alpha);
-        }
-        else {
-            resizedPiece.copyTo(boardMat(Rect(col * BLOCK_SIZE, row * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE)));
-        }
-    }
-    if (selected) {
-        // 선택된 기물 하이라이트
-        Rect r(selectedX * BLOCK_SIZE, selectedY * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE);
-        Mat roi = boardMat(r);
-        Mat selectOverlay(roi.size(), roi.type(), Scalar(0, 0, 255)); // 파란색
-        addWeighted(selectOverlay, 0.4, roi, 0.6, 0, roi);
-
-        for (auto& pos : availableMoves) {
-            Rect moveR(pos.first * BLOCK_SIZE, pos.second * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE);
-            Mat moveRoi = boardMat(moveR);
-            Mat overlay(moveRoi.size(), moveRoi.type(), Scalar(0, 255, 0)); // 녹색
-            addWeighted(overlay, 0.5, moveRoi, 0.5, 0, moveRoi);
-        }
-    }
-    return boardMat;
+// 완료는 그 시점의 g_hMainWnd에 알림. 창이 아직 없으면 (ChessMain에서 모드 선택 중)
+// WM_CREATE가 결과를 확인함
+void StartEngineAsync() {
+    // 엔진 스레드가 부를 수 있으므로 엔진 시작 전에 한 번만 설정 (대국마다 다시 설정하지 않음).
+    // 대국 사이에는 g_hMainWnd가 바뀌므로 그때의 창에 알림
+    g_events.set_wake([] { if (HWND hWnd = g_hMainWnd) PostMessage(hWnd, WM_ENGINE_EVENTS, 0, 0); });
+    g_engineReady = async(launch::async, [] {
+        // 결과 캐시는 엔진이 준비된 뒤(g_engineReady 완료 후)에만 UI 스레드가 사용
+        if (!g_resultCache.open(RESULT_CACHE_PATH, RESULT_CACHE_MB)) StartupLog("result cache unavailable");
+        bool ok = StartEngine();
+        StartupLog(ok ? "engine ready" : "engine failed to start");
+        if (HWND hWnd = g_hMainWnd) PostMessage(hWnd, WM_ENGINE_READY, (WPARAM)ok, 0);
+        return ok;
+    }).share();
 }
 
-HBITMAP matToHBitmap(const Mat& mat) {
-    BITMAPINFOHEADER bi; ZeroMemory(&bi, sizeof(BITMAPINFOHEADER));
-    bi.biSize = sizeof(BITMAPINFOHEADER); bi.biWidth = mat.cols; bi.biHeight = -mat.rows;
-    bi.biPlanes = 1; bi.biBitCount = 24; bi.biCompression = BI_RGB;
-    Mat rgb;
-    if (mat.channels() == 4) cvtColor(mat, rgb, COLOR_BGRA2BGR);
-    else if (mat.channels() == 3) rgb = mat;
-    else if (mat.channels() == 1) cvtColor(mat, rgb, COLOR_GRAY2BGR);
-    else return nullptr;
-    void* ptr = nullptr;
-    HBITMAP hBitmap = CreateDIBSection(NULL, (BITMAPINFO*)&bi, DIB_RGB_COLORS, &ptr, NULL, 0);
-    if (!hBitmap) return nullptr;
-    memcpy(ptr, rgb.data, rgb.total() * rgb.elemSize());
-    return hBitmap;
+bool EngineStarting() {
+    return g_engineReady.valid() && g_engineReady.wait_for(chrono::seconds(0)) != future_status::ready;
 }
 
-pair<int, int> pointToBlock(POINT pt) {
-    // UI 보드가 (25, 25)에서 시작한다고 가정하고 pt에서 오프셋을 뺌
-    pt.x -= 25;
-    pt.y -= 25;
-
-    for (int x = 0; x < BLOCK_COUNT; ++x) {
-        for (int y = 0; y < BLOCK_COUNT; ++y) {
-            // g_block[x][y].rect의 좌표가 0부터 시작한다고 가정하고 계산
-            if (pt.x >= x * BLOCK_SIZE && pt.x < (x + 1) * BLOCK_SIZE &&
-                pt.y >= y * BLOCK_SIZE && pt.y < (y + 1) * BLOCK_SIZE) {
-                return { x, y };
-            }
-        }
+bool EngineReady() {
+    return g_engineReady.valid() && !EngineStarting() && g_engineReady.get();
+}
+
+// 엔진에 국면(시작 국면 + 수순)을 주고 탐색 시작. 명령만 보내고 바로 반환하며
+// 결과는 WM_ENGINE_EVENTS로 도착. 수순을 그대로 보내 엔진도 동형 반복을 알 수 있음
+void StartSearch(const vector<Move>& moves, const SearchLimits& limits) {
+    ClearSearchInfo();
+    g_searchSide = moves.size() % 2 ? BLACK : WHITE;
+    g_session.begin(limits.ponder);
+#ifdef CHESSAI_EMBEDDED_ENGINE
+    if (g_embedded) {
+        g_embedded->set_position(StartFEN, moves);
+        g_embedded->go(limits);
+        return;
     }
-    return { -1,-1 };
+#endif
+    string posCmd = "position startpos moves";
+    for (Move mv : moves) posCmd += " " + Board::uci(mv);
+    g_engine.send(posCmd);
+    g_engine.send(limits.go_command());
 }
 
-void DrawBoardOnBackBuffer(HDC hdc, HWND hWnd) {
-    RECT rc; GetClientRect(hWnd, &rc);
-    int width = rc.right - rc.left, height = rc.bottom - rc.top;
-    if (hdcBack == NULL || hbmBack == NULL || bufferWidth != width || bufferHeight != height) SetupDoubleBuffer(hdc, hWnd);
-    FillRect(hdcBack, &rc, (HBRUSH)(COLOR_WINDOW + 1));
-    Mat boardMat = createBoardImage();
-    HBITMAP hBitmap = matToHBitmap(boardMat);
-    if (hBitmap) {
-        HDC memDC = CreateCompatibleDC(hdc);
-        SelectObject(memDC, hBitmap);
-        // 보드를 (25, 25) 위치에 그립니다.
-        BitBlt(hdcBack, 25, 25, boardMat.cols, boardMat.rows, memDC, 0, 0, SRCCOPY);
-        DeleteDC(memDC);
-        DeleteObject(hBitmap);
+void SendPonderHit() {
+    g_session.ponderhit();
+#ifdef CHESSAI_EMBEDDED_ENGINE
+    if (g_embedded) { g_embedded->ponderhit(); return; }
+#endif
+    g_engine.send("ponderhit");
+}
+
+void SendStop() {
+#ifdef CHESSAI_EMBEDDED_ENGINE
+    if (g_embedded) { g_embedded->stop(); return; }
+#endif
+    g_engine.send("stop");
+}
+
+// 지금 두기: 탐색을 멈추고 그때까지의 최선 수를 둠
+void StopSearch() {
+    if (g_session.stop()) SendStop();
+}
+
+// 탐색 포기: 멈추기만 하고 결과는 버림 (응답을 기다리지 않음)
+void CancelSearch() {
+    g_ponderMove = Move::none();
+    g_aiMovePending = false;
+    if (g_session.cancel()) SendStop();
+}
+
+SearchLimits AILimits() {
+    SearchLimits limits;
+    if (AI_MOVETIME_MS) limits.movetimeMs = AI_MOVETIME_MS;
+    else g_clock.fill(limits);
+    return limits;
+}
+
+// 결과 캐시 적중률 ("cache 12/40 hits, 3 shallow, 25 stored, 2 permille full")
+string ResultCacheReport() {
+    const ResultCache::Stats& st = g_resultCache.stats();
+    return "cache " + to_string(st.hits) + "/" + to_string(st.probes) + " hits, " + to_string(st.shallow) + " shallow, "
+        + to_string(st.stores) + " stored, " + to_string(g_resultCache.fill_permille()) + " permille full";
+}
+
+// 창 제목에 남은 시간과 캐시 적중률 표시 ("Chess Application - White 4:59 | Black 5:00 | cache 12/40 ...")
+void UpdateClockTitle(HWND hWnd) {
+    auto fmt = [](int ms) { int sec = (ms + 999) / 1000; return to_wstring(sec / 60) + (sec % 60 < 10 ? L":0" : L":") + to_wstring(sec % 60); };
+    wstring title = wstring(szTitle) + L" - White " + fmt(g_clock.remaining(WHITE)) + L" | Black " + fmt(g_clock.remaining(BLACK));
+    if (EngineReady() && g_resultCache.is_open()) {
+        string report = ResultCacheReport();
+        title += L" | " + wstring(report.begin(), report.end());
     }
-    BitBlt(hdc, 0, 0, width, height, hdcBack, 0, 0, SRCCOPY);
+    SetWindowTextW(hWnd, title.c_str());
 }
 
-// -------------------- Stockfish integration --------------------
-HANDLE g_hChildStd_IN_Wr = NULL;
-HANDLE g_hChildStd_OUT_Rd = NULL;
-PROCESS_INFORMATION g_piStockfish = { 0 };
-
-bool LaunchStockfish(const wstring& path) {
-    SECURITY_ATTRIBUTES saAttr{}; saAttr.nLength = sizeof(SECURITY_ATTRIBUTES); saAttr.bInheritHandle = TRUE; saAttr.lpSecurityDescriptor = NULL;
-    HANDLE out_read = NULL, out_write = NULL, in_read = NULL, in_write = NULL;
-    if (!CreatePipe(&out_read, &out_write, &saAttr, 0)) return false;
-    if (!SetHandleInformation(out_read, HANDLE_FLAG_INHERIT, 0)) return false;
-    if (!CreatePipe(&in_read, &in_write, &saAttr, 0)) return false;
-    if (!SetHandleInformation(in_write, HANDLE_FLAG_INHERIT, 0)) return false;
-
-    STARTUPINFOW si{}; si.cb = sizeof(STARTUPINFOW); si.hStdError = out_write; si.hStdOutput = out_write; si.hStdInput = in_read; si.dwFlags |= STARTF_USESTDHANDLES;
-    ZeroMemory(&g_piStockfish, sizeof(PROCESS_INFORMATION));
-
-    BOOL ok = CreateProcessW(path.c_str(), NULL, NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &g_piStockfish);
-    if (!ok) { CloseHandle(out_read); CloseHandle(out_write); CloseHandle(in_read); CloseHandle(in_write); return false; }
-
-    // close child side handles
-    CloseHandle(out_write); CloseHandle(in_read);
-
-    // assign global handles for communication
-    g_hChildStd_OUT_Rd = out_read;
-    g_hChildStd_IN_Wr = in_write;
-    return true;
+// -------------------- Game archive --------------------
+// 수를 둔 직후 그 수의 평가(White 기준, 없으면 NO_EVAL)와 둔 쪽의 남은 시간을 기록
+void RecordMove(Color mover, int16_t eval) {
+    g_game.evals.push_back(eval);
+    g_game.clocksMs.push_back(g_clock.remaining(mover));
 }
 
-void WriteToStockfish(const string& cmd) {
-    if (!g_hChildStd_IN_Wr) return;
-    string data = cmd + "\n";
-    DWORD written = 0;
-    WriteFile(g_hChildStd_IN_Wr, data.c_str(), (DWORD)data.size(), &written, NULL);
+// 대국을 한 번만 아카이브에 추가. 파일은 추가할 때만 열어 Chess2Player와 함께 써도 됨
+void ArchiveGame(GameResult result) {
+    if (g_gameArchived || moveHistory.empty()) return;
+    g_gameArchived = true;
+    g_game.moves = moveHistory;
+    g_game.result = result;
+    GameArchive archive;
+    if (!archive.open(GAME_ARCHIVE_PATH) || !archive.append(g_game))
+        StartupLog("cannot append to " GAME_ARCHIVE_PATH);
 }
 
-string ReadFromStockfish(bool waitForBestmove = true) {
-    if (!g_hChildStd_OUT_Rd) return "";
-    string result;
-    CHAR buffer[4096];
-    DWORD read = 0;
+// 새 대국의 기록 시작
+void StartGameRecord() {
+    g_game.clear();
+    g_game.white = "Human";
+    g_game.black = "Stockfish";
+    g_game.startTime = int64_t(time(nullptr));
+    g_game.clockBaseMs = CLOCK_BASE_MS;
+    g_game.clockIncMs = CLOCK_INC_MS;
+    g_gameArchived = false;
+}
 
-    // 5초 타임아웃 추가: 파이프에서 영원히 블로킹되는 것을 방지
-    auto startTime = chrono::high_resolution_clock::now();
-    const chrono::milliseconds timeout(5000); // 5초
+// 엔진이 둔 수의 평가: 마지막 MultiPV 1번 줄의 점수
+int16_t SearchEval() {
+    if (g_searchLines.count == 0) return ArchivedGame::NO_EVAL;
+    const SearchInfo& info = g_searchLines.lines[0].info;
+    return ArchivedGame::to_eval(info.score, info.isMate, g_searchSide);
+}
 
-    while (true) {
-        if (chrono::high_resolution_clock::now() - startTime > timeout) {
-            break;
-        }
+// -------------------- AI Move Logic (Non-blocking) --------------------
+void ApplyAIMove(HWND hWnd, Move bestMove, Move ponderMove, int16_t eval);
 
-        // 파이프에 데이터가 있는지 확인 (PeekNamedPipe)
-        DWORD bytesAvailable = 0;
-        if (!PeekNamedPipe(g_hChildStd_OUT_Rd, NULL, 0, NULL, &bytesAvailable, NULL)) break;
+// 캐시에 넣고 꺼낼 수 있는 국면: 이전에 나온 국면이면 반복 무승부 여부가 수순에 달려 있고,
+// 50수 규칙이 가까우면 남은 수에 달려 있어 국면만으로 결과가 정해지지 않음
+bool CacheablePosition() {
+    return g_resultCache.is_open() && !g_board.is_repetition() && g_board.rule50_count() < 80;
+}
 
-        if (bytesAvailable > 0) {
-            BOOL success = ReadFile(g_hChildStd_OUT_Rd, buffer, sizeof(buffer) - 1, &read, NULL);
-            if (!success || read == 0) break;
-            buffer[read] = '\0';
-            result += buffer;
-        }
+// 지금 국면을 충분히 깊게 탐색한 결과가 캐시에 있으면 탐색 없이 바로 둠
+bool PlayCachedMove(HWND hWnd) {
+    ResultCache::Result r;
+    if (!CacheablePosition() || !g_resultCache.probe(g_board.key(), RESULT_CACHE_MIN_DEPTH, r)) return false;
+    if (!resolveEngineMove(r.best, g_legalMoves)) return false; // 키 충돌
+    ApplyAIMove(hWnd, r.best, r.ponder, ArchivedGame::to_eval(r.score, r.isMate, BLACK));
+    return true;
+}
 
-        if (waitForBestmove) {
-            if (result.find("bestmove") != string::npos) break;
-        }
-        else {
-            if (result.find("readyok") != string::npos) break;
-        }
+// 엔진이 둔 수의 결과(마지막 MultiPV 1번 줄의 점수/깊이)를 지금 국면의 키로 저장
+void StoreSearchResult(Move bestMove, Move ponderMove) {
+    if (!CacheablePosition() || g_searchLines.count == 0) return;
+    const SearchInfo& info = g_searchLines.lines[0].info;
+    ResultCache::Result r;
+    r.best = bestMove;
+    r.ponder = ponderMove;
+    r.score = info.score;
+    r.isMate = info.isMate;
+    r.bound = info.bound;
+    r.depth = info.depth;
+    g_resultCache.store(g_board.key(), r);
+}
+void AskForAIMove(HWND hWnd) {
+    if (g_session.awaiting_move()) return;
+    if (!EngineReady()) {
+        // 아직 시작 중이면 준비되는 대로 요청
+        g_aiMovePending = EngineStarting();
+        return;
+    }
+    g_hMainWnd = hWnd;
+    if (PlayCachedMove(hWnd)) return;
+    StartSearch(moveHistory, AILimits());
+}
+
+// 엔진 수 적용 직후: 엔진이 예상한 사용자 응수를 둔 국면으로 폰더링 시작
+void StartPondering(HWND hWnd, Move ponder) {
+    if (!ponder || !EngineReady()) return;
+    g_hMainWnd = hWnd;
+    g_ponderMove = ponder;
+
+    vector<Move> moves = moveHistory;
+    moves.push_back(ponder);
+    SearchLimits limits = AILimits();
+    limits.ponder = true;
+    StartSearch(moves, limits);
+}
 
-        // 데이터가 없으면 잠시 대기하여 CPU 부하를 줄임
-        if (bytesAvailable == 0) this_thread::sleep_for(chrono::milliseconds(20));
-        else this_thread::sleep_for(chrono::milliseconds(5));
+// 사용자가 수를 둔 직후: 예상이 맞으면 ponderhit로 진행 중인 탐색을 그대로 쓰고,
+// 틀리면 폰더 탐색을 중단(그 bestmove는 무시)하고 새로 탐색
+void OnUserMoved(HWND hWnd, Move m) {
+    if (m == g_ponderMove && g_session.state() == EngineSession::PONDERING) {
+        g_ponderMove = Move::none();
+        SendPonderHit();
+        return;
     }
-    return result;
-}
-
-string parseBestMove(const string& out) {
-    size_t pos = out.find("bestmove ");
-    if (pos == string::npos) return "";
-    size_t start = pos + 9;
-    size_t end = out.find_first_of(" \r\n", start);
-    if (end == string::npos) end = out.size();
-    return out.substr(start, end - start);
-}
-
-// FEN 문자열의 캐슬링 권한 부분 생성
-string getCastlingRights() {
-    string rights = "";
-    if (!whiteKingMoved && !whiteRookH1Moved) rights += 'K';
-    if (!whiteKingMoved && !whiteRookA1Moved) rights += 'Q';
-    if (!blackKingMoved && !blackRookH8Moved) rights += 'k';
-    if (!blackKingMoved && !blackRookA8Moved) rights += 'q';
-    return rights.empty() ? "-" : rights;
-}
-
-// Convert g_block to FEN
-string boardToFEN(Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT], bool whiteTurn) {
-    string fen;
-    for (int y = 0; y < BLOCK_COUNT; ++y) {
-        int empty = 0;
-        for (int x = 0; x < BLOCK_COUNT; ++x) {
-            string piece = board[x][y].name;
-            if (piece.empty()) { empty++; }
-            else {
-                if (empty > 0) { fen += to_string(empty); empty = 0; }
-                if (piece.find("pawn_white") != string::npos) fen.push_back('P');
-                else if (piece.find("pawn_black") != string::npos) fen.push_back('p');
-                else if (piece.find("rook_white") != string::npos) fen.push_back('R');
-                else if (piece.find("rook_black") != string::npos) fen.push_back('r');
-                else if (piece.find("knight_white") != string::npos) fen.push_back('N');
-                else if (piece.find("knight_black") != string::npos) fen.push_back('n');
-                else if (piece.find("bishop_white") != string::npos) fen.push_back('B');
-                else if (piece.find("bishop_black") != string::npos) fen.push_back('b');
-                else if (piece.find("queen_white") != string::npos) fen.push_back('Q');
-                else if (piece.find("queen_black") != string::npos) fen.push_back('q');
-                else if (piece.find("king_white") != string::npos) fen.push_back('K');
-                else if (piece.find("king_black") != string::npos) fen.push_back('k');
-                else fen.push_back('?');
-            }
-        }
-        if (empty > 0) fen += to_string(empty);
-        if (y != BLOCK_COUNT - 1) fen.push_back('/');
+    CancelSearch();
+    AskForAIMove(hWnd);
+}
+
+// 사용자(White) 수 적용: 시계, 보드, 수순 갱신 후 대국 종료 확인, 끝나지 않았으면 AI에 다음 수 요청
+void PlayUserMove(HWND hWnd, Move m) {
+    g_clock.press(); // White 시계 정지 (+증가분), Black 시계 시작
+    g_board.do_move(m);
+    moveHistory.push_back(m);
+    RecordMove(WHITE, ArchivedGame::NO_EVAL);
+    g_legalMoves = g_moveCache.get(g_board);
+
+    // 선택 해제 및 턴 전환 (Black 턴)
+    selected = false;
+    availableMoves = 0;
+    InvalidateBoard(hWnd);
+
+    // 체크메이트/무승부 확인
+    if (detectCheckmate(g_board, g_legalMoves)) {
+        ArchiveGame(RESULT_WHITE_WINS);
+        MessageBoxW(hWnd, L"White wins (checkmate)", L"Game Over", MB_OK);
+        PostQuitMessage(0); return;
+    }
+    if (const wchar_t* draw = detectDraw(g_board, g_legalMoves)) {
+        ArchiveGame(RESULT_DRAW);
+        MessageBoxW(hWnd, draw, L"Game Over", MB_OK);
+        PostQuitMessage(0); return;
     }
 
-    // 턴, 캐슬링 권한, 앙파상 타겟, 하프무브, 풀무브
-    fen += whiteTurn ? " w " : " b ";
-    fen += getCastlingRights() + " "; // 수정된 캐슬링 권한
-    fen += "- 0 1"; // 앙파상, 하프무브, 풀무브 임시값
-
-    return fen;
-}
-
-// Apply uci move like e2e4 to g_block board
-bool applyUCIMoveToBoard(const string& uciMove, Blocks(&board)[BLOCK_COUNT][BLOCK_COUNT]) {
-    if (uciMove.size() < 4) return false;
-    int fileFrom = uciMove[0] - 'a';
-    int rankFrom = 8 - (uciMove[1] - '0');
-    int fileTo = uciMove[2] - 'a';
-    int rankTo = 8 - (uciMove[3] - '0');
-    if (fileFrom < 0 || fileFrom >= 8 || fileTo < 0 || fileTo >= 8 || rankFrom < 0 || rankFrom >= 8 || rankTo < 0 || rankTo >= 8) return false;
-
-    // 프로모션 처리 전에 현재 기물을 복사
-    Blocks movedPiece = board[fileFrom][rankFrom];
-    string movedPieceName = movedPiece.name;
-    bool isKingMove = movedPieceName.find("king") != string::npos;
-    bool isRookMove = movedPieceName.find("rook") != string::npos;
-    bool isWhite = movedPiece.color == TRUE;
-
-    // --- 캐슬링 룩 이동 처리 (AI 또는 사용자) ---
-    // 킹이 2칸 이동하는 경우 (e1g1, e1c1, e8g8, e8c8)
-    if (isKingMove && abs(fileFrom - fileTo) == 2) {
-        int rookFrom, rookTo;
-        if (fileTo == 6) { // 킹사이드 (O-O): e1g1 또는 e8g8
-            rookFrom = 7; // h열
-            rookTo = 5;   // f열
+    // AI (Black)에게 다음 수 요청 (비동기, 폰더링 예상이 맞으면 ponderhit)
+    OnUserMoved(hWnd, m);
+}
+
+// AI 수가 적용된 직후: 가장 먼저 넣은 프리무브를 꺼내 합법 수 목록에서 찾음.
+// 합법이 아니면 나머지 프리무브도 의미가 없으므로 모두 취소하고 Move::none() 반환
+Move TakePremove() {
+    if (g_premoves.empty()) return Move::none();
+    Move pre = g_premoves.front();
+    g_premoves.erase(g_premoves.begin());
+    Move m = g_legalMoves.find(pre.from_sq(), pre.to_sq(), QUEEN); // 프로모션은 퀸으로 자동 승격
+    if (!m) g_premoves.clear();
+    return m;
+}
+
+// AI 수 적용 (엔진 응답 또는 캐시): 대국 종료 확인 후 프리무브를 두거나 폰더링 시작
+// eval: 수의 평가 (White 기준, 대국 기록용)
+void ApplyAIMove(HWND hWnd, Move bestMove, Move ponderMove, int16_t eval) {
+    Move aiMove = resolveEngineMove(bestMove, g_legalMoves);
+
+    if (aiMove) {
+        // 1. AI 이동 적용 (턴 전환: White 턴)
+        g_clock.press();
+        g_board.do_move(aiMove);
+        moveHistory.push_back(aiMove);
+        RecordMove(BLACK, eval);
+        g_legalMoves = g_moveCache.get(g_board);
+        InvalidateBoard(hWnd);
+
+        // 2. 체크메이트/스테일메이트 확인
+        if (detectCheckmate(g_board, g_legalMoves)) {
+            ArchiveGame(RESULT_BLACK_WINS);
+            MessageBoxW(hWnd, L"Black wins (checkmate)", L"Game Over", MB_OK);
+            PostQuitMessage(0);
+        }
+        else if (const wchar_t* draw = detectDraw(g_board, g_legalMoves)) {
+            ArchiveGame(RESULT_DRAW);
+            MessageBoxW(hWnd, draw, L"Game Over", MB_OK);
+            PostQuitMessage(0);
         }
-        else if (fileTo == 2) { // 퀸사이드 (O-O-O): e1c1 또는 e8c8
-            rookFrom = 0; // a열
-            rookTo = 3;   // d열
+        // 3. 프리무브가 있으면 다시 그리기 전에 바로 둠 (사용자 시계는 거의 흐르지 않음)
+        else if (Move pre = TakePremove()) {
+            PlayUserMove(hWnd, pre);
         }
         else {
-            // 킹의 2칸 이동이지만 캐슬링이 아닌 경우는 무시 (있을 수 없음)
-            goto normal_move;
+            // 프리무브로 골라 둔 출발 칸은 이제 일반 선택 (합법 도착 칸 표시)
+            if (selected) {
+                availableMoves = g_legalMoves.targets_from(blockToSquare(selectedX, selectedY));
+                InvalidateBoard(hWnd);
+            }
+            // 4. 사용자 차례 동안 예상 응수로 폰더링
+            StartPondering(hWnd, resolveEngineMove(ponderMove, g_legalMoves));
         }
-
-        // 룩 이동
-        Blocks rookPiece = board[rookFrom][rankFrom];
-        board[rookTo][rankTo] = rookPiece;
-        board[rookTo][rankTo].rect = { rookTo * BLOCK_SIZE, rankTo * BLOCK_SIZE, (rookTo + 1) * BLOCK_SIZE, (rankTo + 1) * BLOCK_SIZE };
-
-        // 원래 룩 자리 비우기
-        board[rookFrom][rankFrom].name.clear();
-        board[rookFrom][rankFrom].color = FALSE;
-        board[rookFrom][rankFrom].type = 0;
     }
+    else {
+        // AI가 수를 찾지 못한 경우 (무승부 또는 오류)
+        MessageBoxW(hWnd, L"AI가 유효한 수를 찾지 못했습니다. (무승부 또는 오류)", L"AI 오류", MB_OK | MB_ICONWARNING);
+    }
+}
 
-normal_move:
-    // 기물 이동
-    board[fileTo][rankTo] = movedPiece;
-    board[fileFrom][rankFrom].name.clear();
-    board[fileFrom][rankFrom].color = FALSE;
-    board[fileFrom][rankFrom].type = 0;
+// 사용자 차례의 화면 상태로 되돌림 (선택 해제, 합법 수/탐색 정보 갱신)
+void ResetTurnState(HWND hWnd) {
+    g_legalMoves = g_moveCache.get(g_board);
+    selected = false;
+    availableMoves = 0;
+    g_premoves.clear();
+    ClearSearchInfo();
+    InvalidateBoard(hWnd);
+}
 
-    // UI 업데이트를 위해 rect도 업데이트 (사실은 매번 다시 그리므로 중요하진 않으나 일관성을 위해)
-    board[fileTo][rankTo].rect = { fileTo * BLOCK_SIZE, rankTo * BLOCK_SIZE, (fileTo + 1) * BLOCK_SIZE, (rankTo + 1) * BLOCK_SIZE };
+// 무르기 (Backspace): AI가 생각 중이면 사용자의 마지막 수 하나, 아니면 AI 수와 함께 두 수를
+// 되돌려 다시 사용자 차례로 만듦. 진행 중인 탐색은 결과를 기다리지 않고 버림
+void TakeBack(HWND hWnd) {
+    size_t plies = g_board.side_to_move() == WHITE ? 2 : 1;
+    if (moveHistory.size() < plies) return;
+    CancelSearch();
+
+    moveHistory.resize(moveHistory.size() - plies);
+    g_game.evals.resize(moveHistory.size());
+    g_game.clocksMs.resize(moveHistory.size());
+    // 되돌림 스택 깊이와 무관하도록 시작 국면부터 다시 둠 (반복 판정도 그대로 유지)
+    g_board.set(StartFEN);
+    for (Move mv : moveHistory) g_board.do_move(mv);
+    g_clock.start(WHITE);
+    ResetTurnState(hWnd);
+}
 
-    // --- 캐슬링 권한 플래그 업데이트 ---
-    if (isKingMove) {
-        if (isWhite) whiteKingMoved = true;
-        else blackKingMoved = true;
+// 새 게임 (F2): 탐색 중이어도 바로 시작. 두던 대국은 미완료로 기록
+void NewGame(HWND hWnd) {
+    CancelSearch();
+    ArchiveGame(RESULT_UNFINISHED);
+    if (EngineReady()) {
+#ifdef CHESSAI_EMBEDDED_ENGINE
+        if (g_embedded) g_embedded->new_game();
+        else
+#endif
+        g_engine.send("ucinewgame");
     }
-    // 룩이 초기 위치(A, H 파일)에서 이동하면 해당 캐슬링 권한을 제거
-    if (isRookMove) {
-        if (isWhite) {
-            if (fileFrom == 0 && rankFrom == 7) whiteRookA1Moved = true; // a1
-            if (fileFrom == 7 && rankFrom == 7) whiteRookH1Moved = true; // h1
-        }
-        else {
-            if (fileFrom == 0 && rankFrom == 0) blackRookA8Moved = true; // a8
-            if (fileFrom == 7 && rankFrom == 0) blackRookH8Moved = true; // h8
-        }
+
+    moveHistory.clear();
+    StartGameRecord();
+    g_board.set(StartFEN);
+    g_clock.reset(CLOCK_BASE_MS, CLOCK_INC_MS);
+    g_clock.start(WHITE);
+    ResetTurnState(hWnd);
+}
+
+// 엔진 종료 (시작 작업이 끝나길 기다린 뒤 quit 전송, 리더 스레드 정리)
+void ShutdownEngine() {
+    if (g_engineReady.valid()) g_engineReady.wait();
+    if (g_resultCache.is_open()) {
+        StartupLog(ResultCacheReport());
+        g_resultCache.close();
     }
-    // ------------------------------------------
-
-    // 프로모션 처리
-    if (uciMove.size() == 5) {
-        char p = uciMove[4];
-        bool isWhitePawn = movedPieceName.find("pawn_white") != string::npos;
-        bool isBlackPawn = movedPieceName.find("pawn_black") != string::npos;
-
-        if (isWhitePawn || isBlackPawn) {
-            string color = isWhitePawn ? "white" : "black";
-            string newPiece;
-            if (p == 'q') newPiece = "queen_" + color + ".png";
-            else if (p == 'r') newPiece = "rook_" + color + ".png";
-            else if (p == 'b') newPiece = "bishop_" + color + ".png";
-            else if (p == 'n') newPiece = "knight_" + color + ".png";
-
-            if (!newPiece.empty()) {
-                board[fileTo][rankTo].name = newPiece;
-            }
-        }
+    g_events.close();
+    g_engine.stop();
+#ifdef CHESSAI_EMBEDDED_ENGINE
+    g_embedded.reset();
+#endif
+}
+
+// -------------------- Game review --------------------
+// 복기가 끝나거나 중단된 뒤 대국으로 복귀 (AI 차례면 다시 수 요청)
+void ResumeGame(HWND hWnd) {
+    g_reviewing = false;
+    g_clock.start(g_board.side_to_move());
+    ResetTurnState(hWnd);
+    if (g_board.side_to_move() == BLACK) AskForAIMove(hWnd);
+}
+
+// 수마다 평가/최선 수/분류를 파일에 쓰고 요약과 처리 속도(국면/초)를 표시
+void FinishReview(HWND hWnd) {
+    g_reviewing = false;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - g_reviewStart).count();
+    vector<MoveReview> moves = g_review.review();
+    int counts[COLOR_NB][MQ_NB] = {};
+    ofstream report(REVIEW_REPORT_PATH);
+    for (size_t ply = 0; ply < moves.size(); ++ply) {
+        report << g_review.report_line(ply, moves[ply]) << "\n";
+        ++counts[moves[ply].side][moves[ply].quality];
     }
 
-    // 앙파상 로직 추가 필요 (현재는 생략)
+    char summary[512];
+    snprintf(summary, sizeof(summary),
+        "White: %d inaccuracies, %d mistakes, %d blunders\nBlack: %d inaccuracies, %d mistakes, %d blunders\n\n"
+        "%zu positions at depth %d in %.1f s (%.1f positions/s)\nDetails: %s",
+        counts[WHITE][MQ_INACCURACY], counts[WHITE][MQ_MISTAKE], counts[WHITE][MQ_BLUNDER],
+        counts[BLACK][MQ_INACCURACY], counts[BLACK][MQ_MISTAKE], counts[BLACK][MQ_BLUNDER],
+        g_review.positions(), REVIEW_DEPTH, seconds, g_review.positions() / max(seconds, 1e-3), REVIEW_REPORT_PATH);
+    report << "\n" << summary << "\n";
+    StartupLog(string("review: ") + to_string(g_review.positions()) + " positions in " + to_string(seconds) + " s");
+
+    string text = summary;
+    MessageBoxW(hWnd, wstring(text.begin(), text.end()).c_str(), L"Game Review", MB_OK);
+    ResumeGame(hWnd);
+}
 
-    return true;
+void ReviewNext() {
+    SearchLimits limits;
+    limits.depth = REVIEW_DEPTH;
+    StartSearch(g_review.moves_to(g_reviewPlies[g_reviewNext]), limits);
 }
 
-// -------------------- AI Move Logic (Non-blocking) --------------------
-void AskForAIMove(HWND hWnd) {
-    if (isThinking) return;
-    isThinking = true;
-
-    // 백그라운드 스레드에서 AI 계산 실행
-    thread aiThread([hWnd]() {
-        // 현재 보드 상태를 FEN으로 변환 (업데이트된 FEN 사용)
-        string fen = boardToFEN(g_block, isWhiteTurn);
-        string posCmd = "position fen " + fen;
-
-        // Stockfish에 명령 전송
-        WriteToStockfish(posCmd);
-        WriteToStockfish("go depth 12");
-
-        // Stockfish 응답 읽기 (최대 5초 대기)
-        string out = ReadFromStockfish(true);
-        string aiMove = parseBestMove(out);
-
-        // UI 스레드에 결과 알림 (힙에 동적 할당하여 데이터 전달)
-        // 메인 스레드에서 이 메모리를 해제해야 함
-        PostMessage(hWnd, WM_STOCKFISH_MOVE_READY, 0, (LPARAM)new string(aiMove));
-        });
-    // 스레드가 완료되면 시스템이 자동으로 리소스를 정리하도록 분리
-    aiThread.detach();
+// 진행 중인 대국을 멈추고 (시계 정지, 탐색 취소) 지금까지의 수순을 복기
+void StartReview(HWND hWnd) {
+    if (g_reviewing || moveHistory.empty() || !EngineReady()) return;
+    CancelSearch();
+    g_clock.stop();
+    g_premoves.clear();
+    selected = false;
+    availableMoves = 0;
+    InvalidateBoard(hWnd);
+
+    g_review.reset(StartFEN, moveHistory);
+    g_reviewPlies = g_review.schedule(0, 1);
+    g_reviewNext = 0;
+    g_reviewing = true;
+    g_reviewStart = chrono::steady_clock::now();
+    if (g_reviewPlies.empty()) FinishReview(hWnd);
+    else ReviewNext();
+}
+
+// 복기 탐색 하나가 끝남: 마지막 MultiPV 1번 줄의 점수와 함께 기록하고 다음 국면으로
+void OnReviewResult(HWND hWnd, Move best) {
+    PositionEval eval;
+    eval.best = best;
+    if (g_searchLines.count > 0) {
+        const SearchInfo& info = g_searchLines.lines[0].info;
+        eval.score = info.score;
+        eval.isMate = info.isMate;
+        eval.depth = info.depth;
+    }
+    g_review.set_eval(g_reviewPlies[g_reviewNext++], eval);
+    if (g_reviewNext < g_reviewPlies.size()) ReviewNext();
+    else FinishReview(hWnd);
+}
+
+void CancelReview(HWND hWnd) {
+    if (!g_reviewing) return;
+    CancelSearch();
+    ResumeGame(hWnd);
 }
 
 // -------------------- Win32 registration / init --------------------
 ATOM MyRegisterClass(HINSTANCE hInstance) {
-    wcscpy_s(szWindowClass, L"MyChessWindowClass");
+    wcscpy_s(szWindowClass, L"ChessAIWindowClass");
     WNDCLASSEXW wcex{}; wcex.cbSize = sizeof(WNDCLASSEX);
     wcex.style = CS_HREDRAW | CS_VREDRAW; wcex.lpfnWndProc = WndProc;
     wcex.cbClsExtra = 0; wcex.cbWndExtra = 0; wcex.hInstance = hInstance;
@@ -687,10 +1008,12 @@ ATOM MyRegisterClass(HINSTANCE hInstance) {
 
 BOOL InitInstance(HINSTANCE hInstance, int nCmdShow) {
     hInst = hInstance;
-    // 창 크기를 보드 크기에 맞게 조정 (+여백)
+    // 처음 창은 칸 크기 BLOCK_SIZE인 보드 + 여백 + 평가 막대/오프닝 패널/PV 줄이 딱 들어가는 크기
+    g_blockSize = BLOCK_SIZE;
+    RECT rc = { 0, 0, BOARD_MARGIN + BOARD_PIXELS + BOARD_RIGHT_SPACE, BOARD_MARGIN + BOARD_PIXELS + BOARD_BOTTOM_SPACE };
+    AdjustWindowRect(&rc, WS_OVERLAPPEDWINDOW, FALSE);
     HWND hWnd = CreateWindowW(szWindowClass, szTitle, WS_OVERLAPPEDWINDOW,
-        CW_USEDEFAULT, 0, BLOCK_SIZE * BLOCK_COUNT + 50, BLOCK_SIZE * BLOCK_COUNT + 70, // 보드 크기 + 여백
-        nullptr, nullptr, hInstance, nullptr);
+        CW_USEDEFAULT, 0, rc.right - rc.left, rc.bottom - rc.top, nullptr, nullptr, hInstance, nullptr);
     if (!hWnd) return FALSE;
     ShowWindow(hWnd, nCmdShow); UpdateWindow(hWnd);
     return TRUE;
@@ -698,137 +1021,188 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow) {
 
 // -------------------- WndProc and event handling --------------------
 LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    static bool inCheck = false;
-    static vector<pair<int, int>> restrictedPieces;
     switch (msg) {
     case WM_CREATE:
-        for (int r = 0; r < BLOCK_COUNT; ++r) for (int c = 0; c < BLOCK_COUNT; ++c) {
-            // rect는 보드 좌표계를 사용하되, 실제 그리는 위치는 DrawBoardOnBackBuffer에서 오프셋 적용
-            g_block[c][r].rect = { c * BLOCK_SIZE, r * BLOCK_SIZE, (c + 1) * BLOCK_SIZE, (r + 1) * BLOCK_SIZE };
-            g_block[c][r].name = pieceImage[r][c];
-            if (g_block[c][r].name.find("white") != string::npos) g_block[c][r].color = TRUE;
-            else if (g_block[c][r].name.find("black") != string::npos) g_block[c][r].color = FALSE;
-            else g_block[c][r].color = FALSE;
+        g_hMainWnd = hWnd;
+        // 이전 창이 닫힌 뒤 도착한 이벤트(취소된 탐색의 bestmove 등)는 버림. 알릴 창이 없어
+        // 깨우기가 보류된 상태이므로, 비워서 다시 걸어야 이 창의 첫 탐색 결과가 도착함
+        g_events.drain([](const EngineEvent& e) {
+            if (e.kind == EngineEvent::BEST_MOVE) g_session.accept(e.searchId); // 취소된 탐색이므로 두지 않음
+        });
+        // 창마다 새 게임 (ChessMain은 같은 엔진으로 여러 번 대국)
+        NewGame(hWnd);
+        // 창이 생기기 전에 엔진 시작이 실패했으면 알림을 놓쳤으므로 다시 보냄
+        g_engineErrorShown = false;
+        if (g_engineReady.valid() && !EngineStarting() && !EngineReady())
+            PostMessage(hWnd, WM_ENGINE_READY, FALSE, 0);
+        SetTimer(hWnd, CLOCK_TIMER_ID, 200, NULL);
+        SetTimer(hWnd, INFO_TIMER_ID, INFO_FRAME_MS, NULL);
+        break;
+
+    case WM_TIMER:
+        if (wParam == INFO_TIMER_ID) { RefreshSearchInfo(hWnd); break; }
+        if (wParam != CLOCK_TIMER_ID) break;
+        UpdateClockTitle(hWnd);
+        // 시간 초과 확인 (시계가 도는 쪽만 줄어듦)
+        if (g_clock.is_running() && g_clock.flagged(g_clock.running_side())) {
+            KillTimer(hWnd, CLOCK_TIMER_ID);
+            g_clock.stop();
+            ArchiveGame(g_clock.running_side() == WHITE ? RESULT_BLACK_WINS : RESULT_WHITE_WINS);
+            MessageBoxW(hWnd, g_clock.running_side() == WHITE ? L"Black wins on time" : L"White wins on time", L"Game Over", MB_OK);
+            PostQuitMessage(0);
         }
         break;
 
     case WM_LBUTTONDOWN: {
-        // AI가 생각 중일 때는 클릭을 무시
-        if (isThinking) break;
+        if (g_reviewing) break; // 복기 중에는 보드 입력 없음
+        POINT pt = { LOWORD(lParam), HIWORD(lParam) };
+        pair<int, int> pos = pointToBlock(pt);
+        if (pos.first == -1 || pos.second == -1) break;
 
-        if (isWhiteTurn) { // 현재는 사용자(White) 턴이라고 가정
-            inCheck = isCheck(isWhiteTurn, g_block);
-            // restrictedPieces는 현재 사용되지 않으나 (getLegalMoves에서 이미 처리), UI에 표시할 경우 사용 가능
-            // restrictedPieces = checkProtectingPieces(isWhiteTurn, g_block); 
+        // AI 차례 (생각 중이거나 엔진 시작 대기 중): 클릭은 프리무브 입력
+        if (g_board.side_to_move() == BLACK) {
+            int x = pos.first, y = pos.second;
+            Square sq = blockToSquare(x, y);
+            Piece view[SQUARE_NB];
+            premoveView(view);
+            bool isOwnPiece = view[sq] != NO_PIECE && color_of(view[sq]) == WHITE;
+
+            if (isOwnPiece) { // 출발 칸 선택 (다른 White 기물을 누르면 선택 변경)
+                selected = !(selected && selectedX == x && selectedY == y);
+                selectedX = x; selectedY = y;
+            }
+            else if (selected) { // 도착 칸: 합법 여부는 AI 수가 온 뒤에 검사
+                g_premoves.push_back(Move(blockToSquare(selectedX, selectedY), sq));
+                selected = false;
+            }
+            availableMoves = 0;
+            InvalidateBoard(hWnd);
+            break;
+        }
 
-            POINT pt = { LOWORD(lParam), HIWORD(lParam) };
-            pair<int, int> pos = pointToBlock(pt);
+        if (g_board.side_to_move() == WHITE) { // 현재는 사용자(White) 턴이라고 가정
             int x = pos.first, y = pos.second;
-            if (x == -1 || y == -1) break;
 
-            bool isPieceOfTurn = !g_block[x][y].name.empty() && g_block[x][y].color == (isWhiteTurn ? TRUE : FALSE);
+            Square sq = blockToSquare(x, y);
+            Piece pc = g_board.piece_on(sq);
+            bool isPieceOfTurn = pc != NO_PIECE && color_of(pc) == g_board.side_to_move();
 
             if (!selected) {
                 if (isPieceOfTurn) {
                     selected = true; selectedX = x; selectedY = y;
-                    Blocks tmpForMove[BLOCK_COUNT][BLOCK_COUNT];
-                    copyBoard(tmpForMove, g_block);
-                    availableMoves = getLegalMoves(selectedX, selectedY, tmpForMove);
-                    InvalidateRect(hWnd, NULL, FALSE); // FALSE: 배경 지우지 않음 (더블 버퍼링 사용)
+                    availableMoves = g_legalMoves.targets_from(sq);
+                    InvalidateBoard(hWnd);
                 }
             }
             else {
-                if (availableMoves.find({ x,y }) != availableMoves.end()) {
-                    // 1. 사용자(White) 이동 적용
-                    Blocks movedPiece = g_block[selectedX][selectedY];
-                    string pieceName = movedPiece.name;
-                    bool isKingMove = pieceName.find("king") != string::npos;
-                    bool isRookMove = pieceName.find("rook") != string::npos;
-
-                    // UCI 무브 생성 및 적용
-                    string moveStr;
-                    moveStr += char('a' + selectedX);
-                    moveStr += char('8' - selectedY);
-                    moveStr += char('a' + x);
-                    moveStr += char('8' - y);
-                    // 프로모션 처리 로직은 생략 (클릭으로는 구현 불가, 별도 UI 필요)
-                    // 지금은 UCI 무브만 생성하고, applyUCIMoveToBoard에서 이동 및 캐슬링 처리
-
-                    if (applyUCIMoveToBoard(moveStr, g_block)) { // 이동 성공
-                        moveHistory.push_back(moveStr);
-
-                        // 선택 해제 및 턴 전환
-                        selected = false;
-                        availableMoves.clear();
-                        isWhiteTurn = !isWhiteTurn; // 턴 전환 (Black 턴)
-                        InvalidateRect(hWnd, NULL, FALSE);
-
-                        // 2. 체크메이트/스테일메이트 확인
-                        if (detectCheckmate(isWhiteTurn, g_block)) {
-                            MessageBoxW(hWnd, L"White wins (checkmate)", L"Game Over", MB_OK);
-                            PostQuitMessage(0); break;
-                        }
-                        // 스테일메이트 (체크가 아니면서 둘 곳이 없는 경우) 확인 로직은 현재 생략됨.
-
-                        // 3. AI (Black)에게 다음 수 요청 (비동기)
-                        AskForAIMove(hWnd);
-                    }
+                if (availableMoves & square_bb(sq)) {
+                    // 프로모션은 클릭으로 기물 선택이 불가하므로 퀸으로 자동 승격
+                    Move m = g_legalMoves.find(blockToSquare(selectedX, selectedY), sq, QUEEN);
+                    if (m) PlayUserMove(hWnd, m); // 캐시된 합법 수 목록에서 찾았으므로 바로 적용
                 }
                 else {
                     // 유효하지 않은 타겟 클릭 -> 선택 해제
                     selected = false;
-                    availableMoves.clear();
-                    InvalidateRect(hWnd, NULL, FALSE);
+                    availableMoves = 0;
+                    InvalidateBoard(hWnd);
                 }
             }
         }
         break;
     }
 
-    case WM_STOCKFISH_MOVE_READY: {
-        // AI 스레드에서 결과를 받아 처리 (메인 UI 스레드에서 실행됨)
-        string* p_aiMove = (string*)lParam;
-        string aiMove = *p_aiMove;
-        delete p_aiMove; // 동적 할당된 메모리 해제
-
-        isThinking = false; // AI 계산 완료
-
-        if (!aiMove.empty()) {
-            // 1. AI 이동 적용
-            applyUCIMoveToBoard(aiMove, g_block);
-            moveHistory.push_back(aiMove);
-            isWhiteTurn = !isWhiteTurn; // 턴 전환 (White 턴)
-            InvalidateRect(hWnd, NULL, FALSE);
-
-            // 2. 체크메이트/스테일메이트 확인
-            if (detectCheckmate(isWhiteTurn, g_block)) {
-                MessageBoxW(hWnd, L"Black wins (checkmate)", L"Game Over", MB_OK);
-                PostQuitMessage(0);
+    case WM_RBUTTONDOWN:
+        // 오른쪽 클릭: 프리무브와 선택 모두 취소
+        if (g_premoves.empty() && !selected) break;
+        g_premoves.clear();
+        selected = false;
+        availableMoves = 0;
+        InvalidateBoard(hWnd);
+        break;
+
+    case WM_ENGINE_EVENTS: {
+        // 엔진 스레드가 쌓아둔 이벤트를 한 번에 처리 (메인 UI 스레드에서 실행됨)
+        // 수 적용은 메시지 박스를 띄울 수 있어, 큐를 다 비운 뒤에 함
+        Move bestMove = Move::none(), ponderMove = Move::none();
+        bool haveMove = false;
+        g_events.drain([&](const EngineEvent& e) {
+            if (e.kind == EngineEvent::INFO) {
+                // 지금 탐색의 info만 표시
+                if (e.searchId == g_session.current()) {
+                    g_searchLines.update(e.info);
+                    g_searchInfoDirty = true;
+                }
+            }
+            // 포기한 탐색(틀린 폰더 예상, 무르기, 새 게임)의 결과는 버림
+            else if (g_session.accept(e.searchId)) {
+                bestMove = e.best;
+                ponderMove = e.ponder;
+                haveMove = true;
             }
-            // 스테일메이트 (체크가 아니면서 둘 곳이 없는 경우) 확인 로직은 현재 생략됨.
+        });
+        if (!haveMove) break;
+        if (g_reviewing) { OnReviewResult(hWnd, bestMove); break; }
+
+        StoreSearchResult(bestMove, ponderMove);
+        ApplyAIMove(hWnd, bestMove, ponderMove, SearchEval());
+        break;
+    }
+
+    case WM_ENGINE_READY:
+        if (!wParam) {
+            // WM_CREATE와 시작 작업이 둘 다 알릴 수 있으므로 창마다 한 번만 표시
+            if (g_engineErrorShown) break;
+            g_engineErrorShown = true;
+            MessageBoxW(hWnd, L"Failed to start Stockfish. Make sure path is correct.", L"Error", MB_OK | MB_ICONERROR);
+            // proceed without engine (UI will still show)
+            break;
         }
-        else {
-            // AI가 수를 찾지 못한 경우 (무승부 또는 오류)
-            isWhiteTurn = !isWhiteTurn; // 턴을 되돌림
-            MessageBoxW(hWnd, L"AI가 유효한 수를 찾지 못했습니다. (무승부 또는 오류)", L"AI 오류", MB_OK | MB_ICONWARNING);
+        if (g_aiMovePending) {
+            g_aiMovePending = false;
+            AskForAIMove(hWnd);
         }
         break;
-    }
+
+    case WM_KEYDOWN:
+        if (g_reviewing) { if (wParam == VK_ESCAPE) CancelReview(hWnd); break; }
+        if (wParam == VK_BACK) TakeBack(hWnd);
+        else if (wParam == VK_F5) StartReview(hWnd);
+        else if (wParam == VK_F2) NewGame(hWnd);
+        else if (wParam == VK_SPACE) StopSearch(); // 지금 두기
+        break;
 
     case WM_PAINT: {
         PAINTSTRUCT ps; HDC hdc = BeginPaint(hWnd, &ps);
-        DrawBoardOnBackBuffer(hdc, hWnd);
+        DrawBoardOnBackBuffer(hdc, hWnd, ps.rcPaint);
         EndPaint(hWnd, &ps);
         break;
     }
 
     case WM_ERASEBKGND: return 1;
-    case WM_SIZE: CleanUpDoubleBuffer(); InvalidateRect(hWnd, NULL, TRUE); break;
+    case WM_SIZE:
+        if (wParam == SIZE_MINIMIZED) break;
+        FitBoardToWindow(hWnd);
+        CleanUpDoubleBuffer();
+        InvalidateRect(hWnd, NULL, TRUE);
+        break;
+    case WM_SPRITES_READY: UpdateBoardSprites(hWnd); break;
+    case WM_DPICHANGED: {
+        // 다른 DPI의 모니터로 옮겨짐: 권장 크기로 바꾸면 WM_SIZE에서 보드가 따라감
+        const RECT* r = (const RECT*)lParam;
+        SetWindowPos(hWnd, NULL, r->left, r->top, r->right - r->left, r->bottom - r->top, SWP_NOZORDER | SWP_NOACTIVATE);
+        break;
+    }
     case WM_DESTROY:
+        KillTimer(hWnd, CLOCK_TIMER_ID);
+        KillTimer(hWnd, INFO_TIMER_ID);
         CleanUpDoubleBuffer();
-        // 엔진 종료
-        WriteToStockfish("quit");
-        if (g_piStockfish.hProcess) { CloseHandle(g_piStockfish.hProcess); CloseHandle(g_piStockfish.hThread); }
+        CleanUpBoardBuffer();
+        CancelSearch();
+        ArchiveGame(RESULT_UNFINISHED); // 끝난 대국이면 이미 저장됨
+        g_hMainWnd = NULL;
+#ifndef CHESSMAIN_HOST
+        ShutdownEngine(); // ChessMain은 다음 대국을 위해 엔진을 살려 두고 종료 시 직접 호출
+#endif
         PostQuitMessage(0);
         break;
     default:
@@ -852,27 +1226,42 @@ INT_PTR CALLBACK About(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
 }
 
 // -------------------- entry point --------------------
-int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int nCmdShow) {
-    MyRegisterClass(hInstance);
-    if (!InitInstance(hInstance, nCmdShow)) return FALSE;
+// 창 하나로 대국을 진행하고 창이 닫히면 반환. 엔진이 아직 시작되지 않았으면 여기서 시작
+int Run(HINSTANCE hInstance, int nCmdShow, const PieceSprites& sprites) {
+    g_sprites = &sprites;
+    g_spriteCache.reset(&sprites, [] { if (HWND hWnd = g_hMainWnd) PostMessage(hWnd, WM_SPRITES_READY, 0, 0); });
+    if (!g_engineReady.valid()) StartEngineAsync(); // 엔진은 백그라운드에서 시작하고 바로 메시지 루프로 들어감
 
-    // Launch Stockfish now (path: change if necessary)
-    if (!LaunchStockfish(L"stockfish\\stockfish-windows-x86-64-avx2.exe")) {
-        MessageBoxW(NULL, L"Failed to start Stockfish. Make sure path is correct.", L"Error", MB_OK | MB_ICONERROR);
-        // proceed without engine (UI will still show)
-    }
-    else {
-        // Stockfish 초기 설정 (초기 응답은 블로킹해도 무방)
-        WriteToStockfish("uci");
-        ReadFromStockfish(false);
-        WriteToStockfish("isready");
-        ReadFromStockfish(false);
-    }
+    // 오프닝 트리는 매핑만 하므로 바로 열림. 없으면 패널에 안내만 표시
+    if (!g_openingTree.is_open() && !g_openingTree.open(OPENING_TREE_PATH)) StartupLog("opening tree unavailable");
+    g_openingKey = 0;
+
+    MyRegisterClass(hInstance); // 이전 대국에서 이미 등록했으면 실패해도 무방
+    if (!InitInstance(hInstance, nCmdShow)) return FALSE;
+    StartupLog("window interactive");
 
     MSG msg;
     while (GetMessage(&msg, nullptr, 0, 0)) {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
+    // 창이 열린 채로 루프가 끝났으면 닫고, WM_DESTROY가 보낸 WM_QUIT은 호출자 루프를 위해 제거
+    if (HWND hWnd = g_hMainWnd) {
+        DestroyWindow(hWnd);
+        MSG quit; PeekMessage(&quit, nullptr, WM_QUIT, WM_QUIT, PM_REMOVE);
+    }
     return (int)msg.wParam;
-}
\ No newline at end of file
+}
+
+#ifndef CHESSMAIN_HOST
+int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int nCmdShow) {
+    ChessCore::init(); // 규칙 코어 공격 테이블 초기화
+    static PieceSprites sprites;
+    sprites.load("", BLOCK_SIZE);
+    return Run(hInstance, nCmdShow, sprites);
+}
+#endif
+
+#ifdef CHESSMAIN_HOST
+} // namespace VsAIMode
+#endif
@@ -0,0 +1,80 @@
+// attacks.cpp: initialization of the attack tables declared in attacks.h
+
+#include "attacks.h"
+
+namespace ChessCore {
+
+namespace Attacks {
+
+Bitboard PawnAttacks[COLOR_NB][SQUARE_NB];
+Bitboard PseudoAttacks[PIECE_TYPE_NB][SQUARE_NB];
+Bitboard Rays[DIRECTION_NB][SQUARE_NB];
+Bitboard BetweenBB[SQUARE_NB][SQUARE_NB];
+Bitboard LineBB[SQUARE_NB][SQUARE_NB];
+
+namespace {
+
+constexpr int DirFile[DIRECTION_NB] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+constexpr int DirRank[DIRECTION_NB] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+
+// Returns the square at (file + df, rank + dr) or SQ_NONE if off the board
+Square offset(Square s, int df, int dr) {
+    int f = file_of(s) + df, r = rank_of(s) + dr;
+    return (f < 0 || f > 7 || r < 0 || r > 7) ? SQ_NONE : make_square(File(f), Rank(r));
+}
+
+Bitboard leaper(Square s, const int (*steps)[2], int count) {
+    Bitboard b = 0;
+    for (int i = 0; i < count; ++i) {
+        Square to = offset(s, steps[i][0], steps[i][1]);
+        if (to != SQ_NONE) b |= square_bb(to);
+    }
+    return b;
+}
+
+} // namespace
+
+void init() {
+    static bool initialized = false;
+    if (initialized) return;
+    initialized = true;
+
+    const int knightSteps[8][2] = { {1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2} };
+    const int kingSteps[8][2] = { {1,0},{-1,0},{0,1},{0,-1},{1,1},{1,-1},{-1,1},{-1,-1} };
+    const int whitePawnSteps[2][2] = { {-1,1},{1,1} };
+    const int blackPawnSteps[2][2] = { {-1,-1},{1,-1} };
+
+    for (int i = SQ_A1; i <= SQ_H8; ++i) {
+        Square s = Square(i);
+        PawnAttacks[WHITE][s] = leaper(s, whitePawnSteps, 2);
+        PawnAttacks[BLACK][s] = leaper(s, blackPawnSteps, 2);
+        PseudoAttacks[KNIGHT][s] = leaper(s, knightSteps, 8);
+        PseudoAttacks[KING][s] = leaper(s, kingSteps, 8);
+
+        for (int d = 0; d < DIRECTION_NB; ++d) {
+            Rays[d][s] = 0;
+            for (Square to = offset(s, DirFile[d], DirRank[d]); to != SQ_NONE; to = offset(to, DirFile[d], DirRank[d]))
+                Rays[d][s] |= square_bb(to);
+        }
+
+        PseudoAttacks[BISHOP][s] = Rays[NORTH_EAST][s] | Rays[SOUTH_EAST][s] | Rays[SOUTH_WEST][s] | Rays[NORTH_WEST][s];
+        PseudoAttacks[ROOK][s] = Rays[NORTH][s] | Rays[EAST][s] | Rays[SOUTH][s] | Rays[WEST][s];
+        PseudoAttacks[QUEEN][s] = PseudoAttacks[BISHOP][s] | PseudoAttacks[ROOK][s];
+    }
+
+    // Opposite rays of a direction d are at index (d + 4) % 8
+    for (int i = SQ_A1; i <= SQ_H8; ++i)
+        for (int j = SQ_A1; j <= SQ_H8; ++j) {
+            Square s1 = Square(i), s2 = Square(j);
+            BetweenBB[s1][s2] = LineBB[s1][s2] = 0;
+            for (int d = 0; d < DIRECTION_NB; ++d)
+                if (Rays[d][s1] & square_bb(s2)) {
+                    BetweenBB[s1][s2] = Rays[d][s1] & Rays[(d + 4) % 8][s2];
+                    LineBB[s1][s2] = Rays[d][s1] | Rays[(d + 4) % 8][s1] | square_bb(s1);
+                }
+        }
+}
+
+} // namespace Attacks
+
+} // namespace ChessCore
@@ -0,0 +1,73 @@
+// attacks.h: precomputed attack tables for the rules core.
+// Leaper attacks are plain table lookups. Slider attacks use per-direction
+// rays: the nearest blocker on a ray is found with one bit scan and the
+// squares behind it are masked off with that blocker's own ray.
+
+#pragma once
+
+#include "chess_types.h"
+
+namespace ChessCore {
+
+enum Direction : uint8_t {
+    NORTH, NORTH_EAST, EAST, SOUTH_EAST, SOUTH, SOUTH_WEST, WEST, NORTH_WEST,
+    DIRECTION_NB
+};
+
+namespace Attacks {
+
+extern Bitboard PawnAttacks[COLOR_NB][SQUARE_NB];
+extern Bitboard PseudoAttacks[PIECE_TYPE_NB][SQUARE_NB];
+extern Bitboard Rays[DIRECTION_NB][SQUARE_NB];
+extern Bitboard BetweenBB[SQUARE_NB][SQUARE_NB];
+extern Bitboard LineBB[SQUARE_NB][SQUARE_NB];
+
+void init();
+
+} // namespace Attacks
+
+// Directions that move towards higher square indices, where the nearest
+// blocker is the least significant bit of the blockers on the ray.
+constexpr bool is_positive(Direction d) {
+    return d == NORTH || d == NORTH_EAST || d == EAST || d == NORTH_WEST;
+}
+
+template<Direction D>
+inline Bitboard ray_attacks(Square s, Bitboard occupied) {
+    Bitboard attacks = Attacks::Rays[D][s];
+    if (Bitboard blockers = attacks & occupied)
+        attacks ^= Attacks::Rays[D][is_positive(D) ? lsb(blockers) : msb(blockers)];
+    return attacks;
+}
+
+inline Bitboard rook_attacks(Square s, Bitboard occupied) {
+    return ray_attacks<NORTH>(s, occupied) | ray_attacks<EAST>(s, occupied)
+         | ray_attacks<SOUTH>(s, occupied) | ray_attacks<WEST>(s, occupied);
+}
+
+inline Bitboard bishop_attacks(Square s, Bitboard occupied) {
+    return ray_attacks<NORTH_EAST>(s, occupied) | ray_attacks<SOUTH_EAST>(s, occupied)
+         | ray_attacks<SOUTH_WEST>(s, occupied) | ray_attacks<NORTH_WEST>(s, occupied);
+}
+
+inline Bitboard pawn_attacks(Color c, Square s) { return Attacks::PawnAttacks[c][s]; }
+
+// Attacks of a piece of type pt (not pawn) on square s with the given occupancy
+inline Bitboard attacks_bb(PieceType pt, Square s, Bitboard occupied) {
+    switch (pt) {
+    case BISHOP: return bishop_attacks(s, occupied);
+    case ROOK:   return rook_attacks(s, occupied);
+    case QUEEN:  return bishop_attacks(s, occupied) | rook_attacks(s, occupied);
+    default:     return Attacks::PseudoAttacks[pt][s];
+    }
+}
+
+// Squares strictly between s1 and s2 when they share a line, otherwise empty
+inline Bitboard between_bb(Square s1, Square s2) { return Attacks::BetweenBB[s1][s2]; }
+
+// The whole line through s1 and s2 (edge to edge) when they are aligned
+inline Bitboard line_bb(Square s1, Square s2) { return Attacks::LineBB[s1][s2]; }
+
+inline bool aligned(Square s1, Square s2, Square s3) { return line_bb(s1, s2) & square_bb(s3); }
+
+} // namespace ChessCore
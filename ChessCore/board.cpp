@@ -0,0 +1,459 @@
+// board.cpp: FEN parsing, Zobrist keys, attack queries, legal moves and move making
+
+#include "board.h"
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <sstream>
+
+#include "legal_moves.h"
+
+namespace ChessCore {
+
+namespace {
+
+constexpr const char* PieceToChar = " PNBRQK  pnbrqk";
+
+// Castling rights lost when a piece leaves or lands on a square
+int castlingRightsMask(Square s) {
+    switch (s) {
+    case SQ_A1: return WHITE_OOO;
+    case SQ_E1: return WHITE_OO | WHITE_OOO;
+    case SQ_H1: return WHITE_OO;
+    case SQ_A8: return BLACK_OOO;
+    case SQ_E8: return BLACK_OO | BLACK_OOO;
+    case SQ_H8: return BLACK_OO;
+    default:    return NO_CASTLING;
+    }
+}
+
+// xorshift64star pseudo-random generator, as in Stockfish's misc.h. The
+// fixed seed keeps keys identical between runs and builds.
+class PRNG {
+public:
+    explicit PRNG(uint64_t seed) : s(seed) {}
+    Key rand() {
+        s ^= s >> 12, s ^= s << 25, s ^= s >> 27;
+        return s * 2685821657736338717ULL;
+    }
+
+private:
+    uint64_t s;
+};
+
+} // namespace
+
+namespace Zobrist {
+
+Key psq[PIECE_NB][SQUARE_NB];
+Key enpassant[FILE_NB];
+Key castling[CASTLING_RIGHT_NB];
+Key side;
+
+void init() {
+    PRNG rng(1070372);
+    for (Piece pc : { W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
+                      B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING })
+        for (int s = SQ_A1; s <= SQ_H8; ++s)
+            psq[pc][s] = rng.rand();
+    for (int f = FILE_A; f <= FILE_H; ++f)
+        enpassant[f] = rng.rand();
+    for (int cr = NO_CASTLING; cr <= ANY_CASTLING; ++cr)
+        castling[cr] = rng.rand();
+    side = rng.rand();
+}
+
+} // namespace Zobrist
+
+void init() {
+    Attacks::init();
+    Zobrist::init();
+}
+
+void Board::clear() {
+    std::memset(board, 0, sizeof(board));
+    std::memset(byTypeBB, 0, sizeof(byTypeBB));
+    std::memset(byColorBB, 0, sizeof(byColorBB));
+    std::memset(pieceAttacks, 0, sizeof(pieceAttacks));
+    kingSquare[WHITE] = kingSquare[BLACK] = SQ_NONE;
+    sideToMove = WHITE;
+    gamePly = 0;
+    stIdx = 0;
+    states[0] = StateInfo{ 0, { 0, 0 }, 0, NO_CASTLING, SQ_NONE, NO_PIECE, 0, 0 };
+}
+
+void Board::put_piece(Piece pc, Square s) {
+    if (type_of(pc) == KING)
+        kingSquare[color_of(pc)] = s;
+    board[s] = pc;
+    byTypeBB[type_of(pc)] |= square_bb(s);
+    byColorBB[color_of(pc)] |= square_bb(s);
+}
+
+void Board::remove_piece(Square s) {
+    Piece pc = board[s];
+    byTypeBB[type_of(pc)] ^= square_bb(s);
+    byColorBB[color_of(pc)] ^= square_bb(s);
+    board[s] = NO_PIECE;
+}
+
+void Board::move_piece(Square from, Square to) {
+    Piece pc = board[from];
+    Bitboard fromTo = square_bb(from) | square_bb(to);
+    byTypeBB[type_of(pc)] ^= fromTo;
+    byColorBB[color_of(pc)] ^= fromTo;
+    board[from] = NO_PIECE;
+    board[to] = pc;
+    if (type_of(pc) == KING)
+        kingSquare[color_of(pc)] = to;
+}
+
+// Attacks of the piece on square s. Sliders see through the enemy king.
+Bitboard Board::attacks_from(Square s) const {
+    Piece pc = board[s];
+    if (type_of(pc) == PAWN)
+        return pawn_attacks(color_of(pc), s);
+    return attacks_bb(type_of(pc), s, pieces() ^ pieces(~color_of(pc), KING));
+}
+
+// Squares whose piece attacks may change when the occupancy of the
+// 'changed' squares changes: those squares themselves and every slider
+// currently reaching one of them.
+Bitboard Board::attack_dependents(Bitboard changed) const {
+    Bitboard dirty = changed;
+    for (Bitboard sliders = pieces(BISHOP) | pieces(ROOK) | pieces(QUEEN); sliders; ) {
+        Square s = pop_lsb(sliders);
+        if (pieceAttacks[s] & changed)
+            dirty |= square_bb(s);
+    }
+    return dirty;
+}
+
+void Board::refresh_attacks(Bitboard dirty) {
+    while (dirty) {
+        Square s = pop_lsb(dirty);
+        pieceAttacks[s] = board[s] != NO_PIECE ? attacks_from(s) : 0;
+    }
+}
+
+// Rebuilds the per-side attack maps and the checkers of the side to move
+// from the per-square attacks
+void Board::set_attack_maps(StateInfo& si) const {
+    for (Color c : { WHITE, BLACK }) {
+        si.attacked[c] = 0;
+        for (Bitboard b = pieces(c); b; )
+            si.attacked[c] |= pieceAttacks[pop_lsb(b)];
+    }
+    Square ksq = kingSquare[sideToMove];
+    si.checkersBB = (si.attacked[~sideToMove] & square_bb(ksq)) ? attackers_to(ksq, pieces()) & pieces(~sideToMove) : 0;
+}
+
+// Squares whose occupancy is changed by a move
+Bitboard Board::changed_squares(Move m, Color us) const {
+    Bitboard b = square_bb(m.from_sq()) | square_bb(m.to_sq());
+    if (m.type_of() == EN_PASSANT)
+        b |= square_bb(Square(m.to_sq() - pawn_push(us)));
+    else if (m.type_of() == CASTLING) {
+        bool kingSide = m.to_sq() > m.from_sq();
+        b |= square_bb(relative_square(us, kingSide ? SQ_H1 : SQ_A1)) | square_bb(relative_square(us, kingSide ? SQ_F1 : SQ_D1));
+    }
+    return b;
+}
+
+// Zobrist key of the current position computed from scratch
+Key Board::compute_key() const {
+    Key k = sideToMove == BLACK ? Zobrist::side : 0;
+    for (Bitboard b = pieces(); b; ) {
+        Square s = pop_lsb(b);
+        k ^= Zobrist::psq[board[s]][s];
+    }
+    if (st().epSquare != SQ_NONE)
+        k ^= Zobrist::enpassant[file_of(st().epSquare)];
+    return k ^ Zobrist::castling[st().castlingRights];
+}
+
+// Finds the previous occurrence of the position in si. Only positions with
+// the same side to move since the last capture or pawn move can repeat, and
+// each of them carries its own repetition flag, so a third occurrence is
+// known without walking further back.
+void Board::set_repetition(StateInfo& si) const {
+    si.repetition = 0;
+    int end = std::min(int(si.rule50), stIdx);
+    for (int i = 4; i <= end; i += 2) {
+        const StateInfo& stp = states[stIdx - i];
+        if (stp.key == si.key) {
+            si.repetition = int16_t(stp.repetition ? -i : i);
+            break;
+        }
+    }
+}
+
+// Initializes the board from a FEN string. Only standard (non-960)
+// castling rights are understood.
+bool Board::set(const std::string& fen) {
+    clear();
+
+    std::istringstream ss(fen);
+    std::string placement, stm, castling, ep;
+    int halfmove = 0, fullmove = 1;
+    ss >> placement >> stm >> castling >> ep;
+    if (placement.empty() || stm.empty())
+        return clear(), false;
+
+    int file = FILE_A, rank = RANK_8;
+    for (char c : placement) {
+        if (c == '/') {
+            if (file != FILE_NB || rank == RANK_1) return clear(), false;
+            file = FILE_A, --rank;
+        }
+        else if (c >= '1' && c <= '8')
+            file += c - '0';
+        else if (const char* p = std::strchr(PieceToChar, c); p && c != ' ' && file < FILE_NB)
+            put_piece(Piece(p - PieceToChar), make_square(File(file++), Rank(rank)));
+        else
+            return clear(), false;
+
+        if (file > FILE_NB) return clear(), false;
+    }
+    if (rank != RANK_1 || file != FILE_NB || popcount(pieces(WHITE, KING)) != 1 || popcount(pieces(BLACK, KING)) != 1)
+        return clear(), false;
+
+    if (stm != "w" && stm != "b") return clear(), false;
+    sideToMove = stm == "w" ? WHITE : BLACK;
+
+    for (char c : castling) {
+        switch (c) {
+        case 'K': st().castlingRights |= WHITE_OO; break;
+        case 'Q': st().castlingRights |= WHITE_OOO; break;
+        case 'k': st().castlingRights |= BLACK_OO; break;
+        case 'q': st().castlingRights |= BLACK_OOO; break;
+        case '-': break;
+        default: return clear(), false;
+        }
+    }
+
+    // Keep the en passant square only if a pawn can capture there, as
+    // do_move() does, so that equal positions get equal keys
+    if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] == (sideToMove == WHITE ? '6' : '3')) {
+        Square epsq = make_square(File(ep[0] - 'a'), Rank(ep[1] - '1'));
+        if (pawn_attacks(~sideToMove, epsq) & pieces(sideToMove, PAWN))
+            st().epSquare = epsq;
+    }
+
+    if (ss >> halfmove >> fullmove) {
+        st().rule50 = uint16_t(halfmove);
+        gamePly = 2 * (fullmove > 1 ? fullmove - 1 : 0) + (sideToMove == BLACK);
+    }
+    else
+        gamePly = sideToMove == BLACK;
+
+    st().key = compute_key();
+    refresh_attacks(pieces());
+    set_attack_maps(st());
+    return true;
+}
+
+std::string Board::fen() const {
+    std::string s;
+    for (int r = RANK_8; r >= RANK_1; --r) {
+        int emptyCnt = 0;
+        for (int f = FILE_A; f <= FILE_H; ++f) {
+            Piece pc = board[make_square(File(f), Rank(r))];
+            if (pc == NO_PIECE) { ++emptyCnt; continue; }
+            if (emptyCnt) { s += char('0' + emptyCnt); emptyCnt = 0; }
+            s += PieceToChar[pc];
+        }
+        if (emptyCnt) s += char('0' + emptyCnt);
+        if (r > RANK_1) s += '/';
+    }
+
+    const int castlingRights = st().castlingRights;
+    const Square epSquare = st().epSquare;
+    s += sideToMove == WHITE ? " w " : " b ";
+    if (castlingRights & WHITE_OO)  s += 'K';
+    if (castlingRights & WHITE_OOO) s += 'Q';
+    if (castlingRights & BLACK_OO)  s += 'k';
+    if (castlingRights & BLACK_OOO) s += 'q';
+    if (!castlingRights) s += '-';
+
+    if (epSquare == SQ_NONE)
+        s += " -";
+    else {
+        s += ' ';
+        s += char('a' + file_of(epSquare));
+        s += char('1' + rank_of(epSquare));
+    }
+
+    s += ' ' + std::to_string(st().rule50) + ' ' + std::to_string(1 + (gamePly - (sideToMove == BLACK)) / 2);
+    return s;
+}
+
+// All pieces of both colors attacking square s, given an occupancy
+Bitboard Board::attackers_to(Square s, Bitboard occupied) const {
+    return (pawn_attacks(BLACK, s) & pieces(WHITE, PAWN))
+         | (pawn_attacks(WHITE, s) & pieces(BLACK, PAWN))
+         | (Attacks::PseudoAttacks[KNIGHT][s] & pieces(KNIGHT))
+         | (rook_attacks(s, occupied) & (pieces(ROOK) | pieces(QUEEN)))
+         | (bishop_attacks(s, occupied) & (pieces(BISHOP) | pieces(QUEEN)))
+         | (Attacks::PseudoAttacks[KING][s] & pieces(KING));
+}
+
+// Pieces of color c that are the only piece between their king and an
+// enemy slider, and so may only move along that line
+Bitboard Board::pinned(Color c) const {
+    Square ksq = king_square(c);
+    Bitboard snipers = ((Attacks::PseudoAttacks[ROOK][ksq] & (pieces(ROOK) | pieces(QUEEN)))
+                      | (Attacks::PseudoAttacks[BISHOP][ksq] & (pieces(BISHOP) | pieces(QUEEN)))) & pieces(~c);
+    Bitboard result = 0;
+    while (snipers) {
+        Bitboard b = between_bb(ksq, pop_lsb(snipers)) & pieces();
+        if (b && !more_than_one(b))
+            result |= b & pieces(c);
+    }
+    return result;
+}
+
+bool Board::legal(Move m) const {
+    return MoveList(*this).contains(m);
+}
+
+Move Board::parse_uci(const std::string& str) const {
+    if (str.size() < 4 || str[0] < 'a' || str[0] > 'h' || str[1] < '1' || str[1] > '8'
+        || str[2] < 'a' || str[2] > 'h' || str[3] < '1' || str[3] > '8')
+        return Move::none();
+
+    Square from = make_square(File(str[0] - 'a'), Rank(str[1] - '1'));
+    Square to = make_square(File(str[2] - 'a'), Rank(str[3] - '1'));
+    PieceType promotion = QUEEN;
+    if (str.size() >= 5)
+        switch (str[4]) {
+        case 'n': promotion = KNIGHT; break;
+        case 'b': promotion = BISHOP; break;
+        case 'r': promotion = ROOK; break;
+        case 'q': promotion = QUEEN; break;
+        default: break;
+        }
+    return MoveList(*this).find(from, to, promotion);
+}
+
+std::string Board::uci(Move m) {
+    if (!m.is_ok())
+        return "0000";
+
+    std::string s;
+    s += char('a' + file_of(m.from_sq()));
+    s += char('1' + rank_of(m.from_sq()));
+    s += char('a' + file_of(m.to_sq()));
+    s += char('1' + rank_of(m.to_sq()));
+    if (m.type_of() == PROMOTION)
+        s += " pnbrqk"[m.promotion_type()];
+    return s;
+}
+
+// Makes a move and pushes the information needed to take it back. The move
+// is assumed to be legal.
+void Board::do_move(Move m) {
+    // Drop the oldest half of the undo stack when it is full
+    if (stIdx == MAX_STATES - 1) {
+        std::memmove(states, states + MAX_STATES / 2, sizeof(StateInfo) * (MAX_STATES / 2));
+        stIdx -= MAX_STATES / 2;
+    }
+
+    StateInfo& prev = st();
+    StateInfo& next = states[++stIdx];
+    next = prev;
+    next.rule50++;
+    next.capturedPiece = NO_PIECE;
+    ++gamePly;
+
+    Color us = sideToMove, them = ~us;
+    Square from = m.from_sq(), to = m.to_sq();
+    Piece pc = board[from];
+    Bitboard dirty = attack_dependents(changed_squares(m, us));
+    Key k = prev.key ^ Zobrist::side;
+
+    if (m.type_of() == CASTLING) {
+        bool kingSide = to > from;
+        Square rfrom = relative_square(us, kingSide ? SQ_H1 : SQ_A1);
+        Square rto = relative_square(us, kingSide ? SQ_F1 : SQ_D1);
+        Piece rook = board[rfrom];
+        move_piece(from, to);
+        move_piece(rfrom, rto);
+        k ^= Zobrist::psq[pc][from] ^ Zobrist::psq[pc][to] ^ Zobrist::psq[rook][rfrom] ^ Zobrist::psq[rook][rto];
+    }
+    else {
+        Square capsq = m.type_of() == EN_PASSANT ? Square(to - pawn_push(us)) : to;
+        if (board[capsq] != NO_PIECE) {
+            next.capturedPiece = board[capsq];
+            k ^= Zobrist::psq[board[capsq]][capsq];
+            remove_piece(capsq);
+            next.rule50 = 0;
+        }
+
+        move_piece(from, to);
+        k ^= Zobrist::psq[pc][from] ^ Zobrist::psq[pc][to];
+
+        if (m.type_of() == PROMOTION) {
+            Piece promoted = make_piece(us, m.promotion_type());
+            remove_piece(to);
+            put_piece(promoted, to);
+            k ^= Zobrist::psq[pc][to] ^ Zobrist::psq[promoted][to];
+        }
+    }
+
+    next.castlingRights &= ~(castlingRightsMask(from) | castlingRightsMask(to));
+    k ^= Zobrist::castling[prev.castlingRights] ^ Zobrist::castling[next.castlingRights];
+
+    // Set the en passant square only if an enemy pawn could capture there
+    if (prev.epSquare != SQ_NONE)
+        k ^= Zobrist::enpassant[file_of(prev.epSquare)];
+    next.epSquare = SQ_NONE;
+    if (type_of(pc) == PAWN) {
+        next.rule50 = 0;
+        if ((int(to) ^ int(from)) == 16 && (pawn_attacks(us, Square(to - pawn_push(us))) & pieces(them, PAWN))) {
+            next.epSquare = Square(to - pawn_push(us));
+            k ^= Zobrist::enpassant[file_of(next.epSquare)];
+        }
+    }
+
+    sideToMove = them;
+    next.key = k;
+    set_repetition(next);
+
+    // Only the pieces touching the changed squares need new attacks
+    refresh_attacks(dirty);
+    set_attack_maps(next);
+}
+
+// Unmakes a move, restoring the board to exactly the state before do_move()
+void Board::undo_move(Move m) {
+    sideToMove = ~sideToMove;
+    Color us = sideToMove;
+    Square from = m.from_sq(), to = m.to_sq();
+    Bitboard dirty = attack_dependents(changed_squares(m, us));
+
+    if (m.type_of() == CASTLING) {
+        bool kingSide = to > from;
+        move_piece(to, from);
+        move_piece(relative_square(us, kingSide ? SQ_F1 : SQ_D1), relative_square(us, kingSide ? SQ_H1 : SQ_A1));
+    }
+    else {
+        if (m.type_of() == PROMOTION) {
+            remove_piece(to);
+            put_piece(make_piece(us, PAWN), to);
+        }
+
+        move_piece(to, from);
+
+        if (Piece captured = st().capturedPiece)
+            put_piece(captured, m.type_of() == EN_PASSANT ? Square(to - pawn_push(us)) : to);
+    }
+
+    // The attack maps come back with the popped state
+    refresh_attacks(dirty);
+    --stIdx;
+    --gamePly;
+}
+
+} // namespace ChessCore
@@ -0,0 +1,128 @@
+// board.h: bitboard position used by the GUIs for rule checks.
+// The board is a plain value type with no heap members. Moves are made and
+// taken back in place with do_move()/undo_move(); legal moves for the side
+// to move come from legal_moves.h.
+
+#pragma once
+
+#include <string>
+
+#include "attacks.h"
+#include "chess_types.h"
+
+namespace ChessCore {
+
+constexpr const char* StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Initializes the attack and Zobrist tables. Must be called once before any
+// Board is used.
+void init();
+
+// Information needed to restore a Board to its previous state after
+// undo_move(), modeled on Stockfish's StateInfo. Each do_move() pushes one
+// entry on a fixed-size stack inside the Board.
+struct StateInfo {
+    Key key;                     // Zobrist key of the position
+    Bitboard attacked[COLOR_NB]; // Squares attacked by each side
+    Bitboard checkersBB;
+    uint8_t castlingRights;
+    Square epSquare;
+    Piece capturedPiece; // Piece captured by the move that led here
+    uint16_t rule50;
+    int16_t repetition;  // Plies back to the same position, negative if that was already a repetition
+};
+
+class Board {
+public:
+    // Depth of the undo stack. When a game gets longer than this, the oldest
+    // half of the stack is dropped and those moves can no longer be undone.
+    static constexpr int MAX_STATES = 1024;
+
+    Board() { clear(); }
+
+    // FEN string input/output. set() returns false on a malformed FEN and
+    // leaves the board empty.
+    bool set(const std::string& fen);
+    std::string fen() const;
+
+    // Position representation
+    Bitboard pieces() const { return byColorBB[WHITE] | byColorBB[BLACK]; }
+    Bitboard pieces(Color c) const { return byColorBB[c]; }
+    Bitboard pieces(PieceType pt) const { return byTypeBB[pt]; }
+    Bitboard pieces(Color c, PieceType pt) const { return byColorBB[c] & byTypeBB[pt]; }
+    Piece piece_on(Square s) const { return board[s]; }
+    bool empty(Square s) const { return board[s] == NO_PIECE; }
+    Square king_square(Color c) const { return kingSquare[c]; }
+
+    // Position state
+    Color side_to_move() const { return sideToMove; }
+    int castling_rights() const { return st().castlingRights; }
+    Square ep_square() const { return st().epSquare; }
+    int rule50_count() const { return st().rule50; }
+    int game_ply() const { return gamePly; }
+    Piece captured_piece() const { return st().capturedPiece; }
+    int undo_depth() const { return stIdx; }
+    Key key() const { return st().key; }
+
+    // Draws by rule. The repetition distance is found once in do_move(), so
+    // these are plain lookups. Checkmate on the 100th half-move still wins,
+    // so test for mate first.
+    bool is_threefold() const { return st().repetition < 0; }
+    // The position occurred before in the game, so the result may depend on
+    // how it was reached
+    bool is_repetition() const { return st().repetition != 0; }
+    bool is_fifty_moves() const { return st().rule50 >= 100; }
+    bool is_draw() const { return is_threefold() || is_fifty_moves(); }
+
+    // Attacks and checks. The attack maps are kept up to date by
+    // do_move()/undo_move(); sliders see through the enemy king, so a king
+    // cannot step back along the line of a slider checking it.
+    Bitboard attackers_to(Square s, Bitboard occupied) const;
+    Bitboard attacked(Color c) const { return st().attacked[c]; }
+    bool attacked_by(Color c, Square s) const { return st().attacked[c] & square_bb(s); }
+    bool in_check() const { return st().checkersBB; }
+    Bitboard checkers() const { return st().checkersBB; }
+    Bitboard pinned(Color c) const;
+
+    // Full legality test against the generated move list. Prefer keeping a
+    // MoveList when testing many moves of the same position.
+    bool legal(Move m) const;
+
+    // UCI move strings ("e2e4", "e7e8q"). parse_uci() returns Move::none()
+    // for a malformed or illegal move.
+    Move parse_uci(const std::string& str) const;
+    static std::string uci(Move m);
+
+    // Doing and undoing moves. do_move() assumes the move is legal;
+    // undo_move() must be given the last move done.
+    void do_move(Move m);
+    void undo_move(Move m);
+
+private:
+    StateInfo& st() { return states[stIdx]; }
+    const StateInfo& st() const { return states[stIdx]; }
+
+    void clear();
+    void put_piece(Piece pc, Square s);
+    void remove_piece(Square s);
+    void move_piece(Square from, Square to);
+    Bitboard attacks_from(Square s) const;
+    Bitboard attack_dependents(Bitboard changed) const;
+    void refresh_attacks(Bitboard dirty);
+    void set_attack_maps(StateInfo& si) const;
+    Bitboard changed_squares(Move m, Color us) const;
+    Key compute_key() const;
+    void set_repetition(StateInfo& si) const;
+
+    Piece board[SQUARE_NB];
+    Bitboard byTypeBB[PIECE_TYPE_NB];
+    Bitboard byColorBB[COLOR_NB];
+    Bitboard pieceAttacks[SQUARE_NB]; // Attacks of the piece on each square
+    Square kingSquare[COLOR_NB];
+    Color sideToMove;
+    int gamePly;
+    StateInfo states[MAX_STATES];
+    int stIdx;
+};
+
+} // namespace ChessCore
@@ -0,0 +1,120 @@
+// board_renderer.cpp: dirty-square board rendering
+
+#include "board_renderer.h"
+
+#include <algorithm>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "board.h"
+#include "piece_sprites.h"
+
+namespace ChessCore {
+
+namespace {
+
+const cv::Scalar LightSquare(175, 223, 240);
+const cv::Scalar DarkSquare(99, 136, 181);
+
+// dst = dst * (1 - alpha) + colour * alpha over a BGR rectangle, in place;
+// alpha out of 256
+void blend(cv::Mat roi, const uchar bgr[3], int alpha) {
+    int inv = 256 - alpha;
+    int b = bgr[0] * alpha, g = bgr[1] * alpha, r = bgr[2] * alpha;
+    for (int y = 0; y < roi.rows; ++y) {
+        uchar* p = roi.ptr<uchar>(y);
+        for (int x = 0; x < roi.cols; ++x, p += 3) {
+            p[0] = uchar((p[0] * inv + b) >> 8);
+            p[1] = uchar((p[1] * inv + g) >> 8);
+            p[2] = uchar((p[2] * inv + r) >> 8);
+        }
+    }
+}
+
+} // namespace
+
+BoardFrame make_frame(const Board& board, const BoardHighlights& highlights) {
+    BoardFrame frame;
+    for (int s = SQ_A1; s <= SQ_H8; ++s)
+        frame.pieces[s] = board.piece_on(Square(s));
+    for (Bitboard b = highlights.premoves; b; )
+        frame.marks[pop_lsb(b)] |= MARK_PREMOVE;
+    if (highlights.selected != SQ_NONE)
+        frame.marks[highlights.selected] |= MARK_SELECTED;
+    for (Bitboard b = highlights.targets; b; )
+        frame.marks[pop_lsb(b)] |= MARK_TARGET;
+    return frame;
+}
+
+void BoardRenderer::reset(const PieceSprites* pieceSprites, int size, cv::Mat target) {
+    sprites = pieceSprites;
+    squareSize = size;
+    int pixels = 8 * size;
+    if (target.empty())
+        target.create(pixels, pixels, CV_8UC3);
+    CV_Assert(target.type() == CV_8UC3 && target.rows == pixels && target.cols == pixels);
+    frame = target;
+
+    background.create(pixels, pixels, CV_8UC3);
+    for (int s = SQ_A1; s <= SQ_H8; ++s) {
+        cv::Rect r = square_rect(Square(s));
+        bool light = (file_of(Square(s)) + rank_of(Square(s))) % 2 != 0;
+        cv::rectangle(background, r, light ? LightSquare : DarkSquare, cv::FILLED);
+        cv::rectangle(background, r, cv::Scalar(0, 0, 0), 1);
+    }
+    valid = false;
+}
+
+void BoardRenderer::set_mark_style(SquareMark mark, const cv::Scalar& color, double opacity) {
+    for (MarkStyle& m : styles)
+        if (m.mark == mark) {
+            for (int c = 0; c < 3; ++c)
+                m.bgr[c] = cv::saturate_cast<uchar>(color[c]);
+            m.alpha = cv::saturate_cast<int>(std::min(std::max(opacity, 0.0), 1.0) * 256);
+        }
+    valid = false;
+}
+
+cv::Rect BoardRenderer::square_rect(Square s) const {
+    return cv::Rect(file_of(s) * squareSize, (7 - rank_of(s)) * squareSize, squareSize, squareSize);
+}
+
+void BoardRenderer::draw_square(Square s, Piece pc, uint8_t marks) {
+    cv::Rect r = square_rect(s);
+    cv::Mat roi = frame(r);
+    background(r).copyTo(roi);
+    // Without a sprite the piece is named instead, so a missing image shows
+    if (pc != NO_PIECE && !(sprites && sprites->draw(frame, pc, r)))
+        cv::putText(roi, PieceSprites::file_name(pc), cv::Point(5, squareSize / 2), cv::FONT_HERSHEY_SIMPLEX,
+                    0.5, cv::Scalar(0, 0, 0), 1);
+    for (const MarkStyle& m : styles)
+        if (marks & m.mark)
+            blend(roi, m.bgr, m.alpha);
+}
+
+Bitboard BoardRenderer::update(const BoardFrame& next) {
+    Bitboard dirty = 0;
+    for (int s = SQ_A1; s <= SQ_H8; ++s)
+        if (!valid || next.pieces[s] != shown.pieces[s] || next.marks[s] != shown.marks[s]) {
+            draw_square(Square(s), next.pieces[s], next.marks[s]);
+            dirty |= square_bb(Square(s));
+        }
+    shown = next;
+    valid = true;
+    return dirty;
+}
+
+bool BoardRenderer::write_png(const std::string& path) const {
+    return !frame.empty() && cv::imwrite(path, frame);
+}
+
+cv::Mat render_board(const Board& board, const BoardHighlights& highlights, const PieceSprites* sprites,
+                     int squareSize) {
+    BoardRenderer renderer;
+    renderer.reset(sprites, squareSize);
+    renderer.update(make_frame(board, highlights));
+    return renderer.image();
+}
+
+} // namespace ChessCore
@@ -0,0 +1,115 @@
+// board_renderer.h: incremental OpenCV board renderer for the GUIs.
+// The board is kept in a persistent framebuffer. The empty squares with
+// their outlines are drawn once into a static background layer. Each
+// update() compares the requested frame (piece and highlight marks per
+// square) with the one on screen and redraws only the squares that differ:
+// background copied back, piece composited, highlights blended in place.
+// Selecting a piece therefore touches the selected square and its targets,
+// and a move touches the squares it changes; update() returns those squares
+// so the caller can copy just them to the screen. No Win32 here: the GUIs
+// point the framebuffer at their DIB section, tools at a plain Mat, and
+// render_board() draws a position into a new image (or a PNG) headlessly.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "chess_types.h"
+
+namespace ChessCore {
+
+class Board;
+class PieceSprites;
+
+// Highlights of a square, blended over the piece in this order
+enum SquareMark : uint8_t {
+    MARK_NONE     = 0,
+    MARK_PREMOVE  = 1 << 0, // Queued premove square
+    MARK_SELECTED = 1 << 1, // Selected piece
+    MARK_TARGET   = 1 << 2  // Legal destination of the selected piece
+};
+
+// Everything the board shows, square by square
+struct BoardFrame {
+    Piece pieces[SQUARE_NB] = {};
+    uint8_t marks[SQUARE_NB] = {}; // SquareMark bits
+};
+
+// Highlights of a position, as the GUIs show them
+struct BoardHighlights {
+    Bitboard premoves = 0; // From and to squares of queued premoves
+    Square selected = SQ_NONE;
+    Bitboard targets = 0;  // Legal destinations of the selected piece
+};
+
+// The frame showing 'board' with 'highlights'
+BoardFrame make_frame(const Board& board, const BoardHighlights& highlights = BoardHighlights());
+
+class BoardRenderer {
+public:
+    // Squares are squareSize pixels, a1 at the bottom left. 'target' is the
+    // framebuffer (CV_8UC3, 8 * squareSize square); pass an empty Mat to let
+    // the renderer own it. Everything is redrawn by the next update().
+    void reset(const PieceSprites* sprites, int squareSize, cv::Mat target = cv::Mat());
+
+    // Draws with other sprites from the next update() on, e.g. once the
+    // sprites for the current square size are ready
+    void set_sprites(const PieceSprites* pieceSprites) {
+        if (pieceSprites != sprites) {
+            sprites = pieceSprites;
+            valid = false;
+        }
+    }
+
+    // Marks every square for redrawing, e.g. after the framebuffer was
+    // copied over by something else
+    void invalidate() { valid = false; }
+
+    // Colour (BGR) and opacity (0 to 1) of a highlight; the defaults are
+    // ChessAI's. Takes effect on every square at the next update().
+    void set_mark_style(SquareMark mark, const cv::Scalar& color, double opacity);
+
+    // Brings the framebuffer to 'next'; returns the squares redrawn
+    Bitboard update(const BoardFrame& next);
+
+    const cv::Mat& image() const { return frame; }
+    // Writes the framebuffer as a PNG (or any format cv::imwrite knows by
+    // the extension)
+    bool write_png(const std::string& path) const;
+    int square_size() const { return squareSize; }
+    // Pixel rectangle of a square in the framebuffer
+    cv::Rect square_rect(Square s) const;
+
+private:
+    struct MarkStyle {
+        SquareMark mark;
+        uchar bgr[3];
+        int alpha; // Out of 256
+    };
+
+    void draw_square(Square s, Piece pc, uint8_t marks);
+
+    // In blending order
+    MarkStyle styles[3] = {
+        { MARK_PREMOVE,  { 200, 130,  40 }, 102 }, // Teal, 40%
+        { MARK_SELECTED, {   0,   0, 255 }, 102 }, // Red, 40%
+        { MARK_TARGET,   {   0, 255,   0 }, 128 }  // Green, 50%
+    };
+
+    const PieceSprites* sprites = nullptr;
+    int squareSize = 0;
+    cv::Mat background; // Empty board
+    cv::Mat frame;
+    BoardFrame shown;
+    bool valid = false;
+};
+
+// Draws 'board' with 'highlights' into a new 8 * squareSize square BGR
+// image, without a window
+cv::Mat render_board(const Board& board, const BoardHighlights& highlights, const PieceSprites* sprites,
+                     int squareSize);
+
+} // namespace ChessCore
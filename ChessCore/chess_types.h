@@ -0,0 +1,154 @@
+// chess_types.h: basic types shared by the rules core and both GUIs.
+// Square numbering follows Stockfish (a1 = 0, h8 = 63) so that moves and
+// FEN strings can be exchanged with the engine without translation.
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ChessCore {
+
+using Bitboard = uint64_t;
+using Key = uint64_t;
+
+enum Color : uint8_t { WHITE, BLACK, COLOR_NB = 2 };
+
+enum PieceType : uint8_t {
+    NO_PIECE_TYPE, PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING,
+    PIECE_TYPE_NB = 8
+};
+
+enum Piece : uint8_t {
+    NO_PIECE,
+    W_PAWN = PAWN,     W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
+    B_PAWN = PAWN + 8, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING,
+    PIECE_NB = 16
+};
+
+enum Square : int8_t {
+    SQ_A1, SQ_B1, SQ_C1, SQ_D1, SQ_E1, SQ_F1, SQ_G1, SQ_H1,
+    SQ_A2, SQ_B2, SQ_C2, SQ_D2, SQ_E2, SQ_F2, SQ_G2, SQ_H2,
+    SQ_A3, SQ_B3, SQ_C3, SQ_D3, SQ_E3, SQ_F3, SQ_G3, SQ_H3,
+    SQ_A4, SQ_B4, SQ_C4, SQ_D4, SQ_E4, SQ_F4, SQ_G4, SQ_H4,
+    SQ_A5, SQ_B5, SQ_C5, SQ_D5, SQ_E5, SQ_F5, SQ_G5, SQ_H5,
+    SQ_A6, SQ_B6, SQ_C6, SQ_D6, SQ_E6, SQ_F6, SQ_G6, SQ_H6,
+    SQ_A7, SQ_B7, SQ_C7, SQ_D7, SQ_E7, SQ_F7, SQ_G7, SQ_H7,
+    SQ_A8, SQ_B8, SQ_C8, SQ_D8, SQ_E8, SQ_F8, SQ_G8, SQ_H8,
+    SQ_NONE,
+    SQUARE_NB = 64
+};
+
+enum File : int8_t { FILE_A, FILE_B, FILE_C, FILE_D, FILE_E, FILE_F, FILE_G, FILE_H, FILE_NB };
+enum Rank : int8_t { RANK_1, RANK_2, RANK_3, RANK_4, RANK_5, RANK_6, RANK_7, RANK_8, RANK_NB };
+
+enum CastlingRights : uint8_t {
+    NO_CASTLING,
+    WHITE_OO  = 1,
+    WHITE_OOO = 2,
+    BLACK_OO  = 4,
+    BLACK_OOO = 8,
+    ANY_CASTLING = 15,
+    CASTLING_RIGHT_NB = 16
+};
+
+constexpr Color operator~(Color c) { return Color(c ^ BLACK); }
+
+constexpr Square make_square(File f, Rank r) { return Square((r << 3) + f); }
+constexpr File file_of(Square s) { return File(s & 7); }
+constexpr Rank rank_of(Square s) { return Rank(s >> 3); }
+constexpr bool is_ok(Square s) { return s >= SQ_A1 && s <= SQ_H8; }
+constexpr Rank relative_rank(Color c, Rank r) { return Rank(r ^ (c * 7)); }
+constexpr Square relative_square(Color c, Square s) { return Square(s ^ (c * 56)); }
+constexpr int pawn_push(Color c) { return c == WHITE ? 8 : -8; }
+
+constexpr Piece make_piece(Color c, PieceType pt) { return Piece((c << 3) + pt); }
+constexpr PieceType type_of(Piece pc) { return PieceType(pc & 7); }
+constexpr Color color_of(Piece pc) { return Color(pc >> 3); }
+
+constexpr Bitboard square_bb(Square s) { return Bitboard(1) << s; }
+
+// A move needs 16 bits to be stored, the same layout Stockfish uses:
+// bit  0- 5: destination square (0 to 63)
+// bit  6-11: origin square (0 to 63)
+// bit 12-13: promotion piece type - 2 (from KNIGHT-2 to QUEEN-2)
+// bit 14-15: special move flag: promotion (1), en passant (2), castling (3)
+// Unlike Stockfish, castling is encoded as king origin to king destination
+// (e1g1), which is what both the GUI and UCI use.
+enum MoveType : uint16_t {
+    NORMAL,
+    PROMOTION  = 1 << 14,
+    EN_PASSANT = 2 << 14,
+    CASTLING   = 3 << 14
+};
+
+class Move {
+public:
+    Move() = default;
+    constexpr explicit Move(uint16_t d) : data(d) {}
+    constexpr Move(Square from, Square to) : data(uint16_t((from << 6) + to)) {}
+
+    template<MoveType T>
+    static constexpr Move make(Square from, Square to, PieceType pt = KNIGHT) {
+        return Move(uint16_t(T + ((pt - KNIGHT) << 12) + (from << 6) + to));
+    }
+
+    constexpr Square from_sq() const { return Square((data >> 6) & 0x3F); }
+    constexpr Square to_sq() const { return Square(data & 0x3F); }
+    constexpr MoveType type_of() const { return MoveType(data & (3 << 14)); }
+    constexpr PieceType promotion_type() const { return PieceType(((data >> 12) & 3) + KNIGHT); }
+
+    constexpr bool is_ok() const { return none().data != data; }
+    static constexpr Move none() { return Move(0); }
+
+    constexpr bool operator==(const Move& m) const { return data == m.data; }
+    constexpr bool operator!=(const Move& m) const { return data != m.data; }
+    constexpr explicit operator bool() const { return data != 0; }
+
+    constexpr uint16_t raw() const { return data; }
+
+protected:
+    uint16_t data;
+};
+
+inline int popcount(Bitboard b) {
+#if defined(_MSC_VER)
+    return int(__popcnt64(b));
+#else
+    return __builtin_popcountll(b);
+#endif
+}
+
+inline Square lsb(Bitboard b) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, b);
+    return Square(idx);
+#else
+    return Square(__builtin_ctzll(b));
+#endif
+}
+
+inline Square msb(Bitboard b) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse64(&idx, b);
+    return Square(idx);
+#else
+    return Square(63 ^ __builtin_clzll(b));
+#endif
+}
+
+// Finds and clears the least significant bit of a non-zero bitboard
+inline Square pop_lsb(Bitboard& b) {
+    const Square s = lsb(b);
+    b &= b - 1;
+    return s;
+}
+
+inline bool more_than_one(Bitboard b) { return b & (b - 1); }
+
+} // namespace ChessCore
@@ -0,0 +1,174 @@
+// embedded_engine.cpp: adapter between Stockfish::Engine and ChessCore
+
+#include "embedded_engine.h"
+
+#include <charconv>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "bitboard.h"
+#include "engine.h"
+#include "evaluate.h"
+#include "misc.h"
+#include "position.h"
+#include "score.h"
+#include "search.h"
+
+namespace ChessCore {
+
+namespace {
+
+// Stockfish's own tables, normally set up by its main()
+void init_stockfish() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        Stockfish::Bitboards::init();
+        Stockfish::Position::init();
+    });
+}
+
+// Same conversion as UCIEngine::format_score()
+void set_score(SearchInfo& info, const Stockfish::Score& score) {
+    using Stockfish::Score;
+    constexpr int TB_CP = 20000;
+
+    if (score.is<Score::Mate>()) {
+        int plies = score.get<Score::Mate>().plies;
+        info.isMate = true;
+        info.score = (plies > 0 ? plies + 1 : plies) / 2;
+    }
+    else if (score.is<Score::Tablebase>()) {
+        Score::Tablebase tb = score.get<Score::Tablebase>();
+        info.score = tb.win ? TB_CP - tb.plies : -TB_CP - tb.plies;
+    }
+    else
+        info.score = score.get<Score::InternalUnits>().value;
+}
+
+// full.wdl is "W D L" per mille, or empty when UCI_ShowWDL is off
+void set_wdl(SearchInfo& info, std::string_view wdl) {
+    const char* p = wdl.data();
+    const char* end = p + wdl.size();
+    for (int i = 0; i < 3; ++i) {
+        while (p < end && *p == ' ')
+            ++p;
+        auto [next, ec] = std::from_chars(p, end, info.wdl[i]);
+        if (ec != std::errc())
+            return;
+        p = next;
+    }
+    info.hasWdl = true;
+}
+
+bool file_exists(const std::string& path) {
+    return std::ifstream(path).good();
+}
+
+} // namespace
+
+bool EmbeddedEngine::networks_available(const std::string& binaryPath) {
+    std::string dir = Stockfish::CommandLine::get_binary_directory(binaryPath);
+    for (const char* name : { EvalFileDefaultNameBig, EvalFileDefaultNameSmall })
+        if (!file_exists(name) && !file_exists(dir + name))
+            return false;
+    return true;
+}
+
+EmbeddedEngine::EmbeddedEngine(const std::string& binaryPath, Handlers h) : handlers(std::move(h)) {
+    init_stockfish();
+    engine = std::make_unique<Stockfish::Engine>(binaryPath);
+    position.set(StartFEN);
+
+    engine->set_on_update_full([this](const Stockfish::Engine::InfoFull& full) {
+        if (!handlers.onInfo)
+            return;
+        SearchInfo info;
+        info.depth = full.depth;
+        info.selDepth = full.selDepth;
+        info.multiPV = int(full.multiPV);
+        set_score(info, full.score);
+        info.bound = full.bound == "lowerbound" ? BOUND_LOWER
+                   : full.bound == "upperbound" ? BOUND_UPPER : BOUND_EXACT;
+        set_wdl(info, full.wdl);
+        info.nodes = full.nodes;
+        info.nps = full.nps;
+        info.tbHits = full.tbHits;
+        info.hashfull = full.hashfull;
+        info.timeMs = int(full.timeMs);
+        info.pv = full.pv;
+        handlers.onInfo(info);
+    });
+
+    engine->set_on_bestmove([this](std::string_view best, std::string_view ponder) {
+        if (!handlers.onBestMove)
+            return;
+        // The engine's position is set from 'position', so its moves parse
+        // against it without any ambiguity
+        Move bestMove = position.parse_uci(std::string(best));
+        Move ponderMove = Move::none();
+        if (bestMove && !ponder.empty()) {
+            position.do_move(bestMove);
+            ponderMove = position.parse_uci(std::string(ponder));
+            position.undo_move(bestMove);
+        }
+        handlers.onBestMove(bestMove, ponderMove);
+    });
+}
+
+EmbeddedEngine::~EmbeddedEngine() {
+    stop();
+    wait();
+}
+
+void EmbeddedEngine::set_option(const std::string& name, const std::string& value) {
+    std::istringstream is("name " + name + " value " + value);
+    engine->get_options().setoption(is);
+}
+
+void EmbeddedEngine::new_game() {
+    engine->search_clear();
+}
+
+void EmbeddedEngine::set_position(const std::string& fen, const std::vector<Move>& moves) {
+    engine->wait_for_search_finished();
+
+    std::vector<std::string> uciMoves;
+    uciMoves.reserve(moves.size());
+    position.set(fen);
+    for (Move m : moves) {
+        uciMoves.push_back(Board::uci(m));
+        position.do_move(m);
+    }
+    engine->set_position(fen, uciMoves);
+}
+
+void EmbeddedEngine::go(const SearchLimits& limits) {
+    Stockfish::Search::LimitsType sl;
+    sl.startTime = Stockfish::now();
+    sl.depth = limits.depth;
+    sl.movetime = limits.movetimeMs;
+    sl.nodes = limits.nodes;
+    sl.time[Stockfish::WHITE] = limits.timeMs[WHITE];
+    sl.time[Stockfish::BLACK] = limits.timeMs[BLACK];
+    sl.inc[Stockfish::WHITE] = limits.incMs[WHITE];
+    sl.inc[Stockfish::BLACK] = limits.incMs[BLACK];
+    sl.movestogo = limits.movestogo;
+    sl.infinite = limits.infinite;
+    sl.ponderMode = limits.ponder;
+    engine->go(sl);
+}
+
+void EmbeddedEngine::stop() {
+    engine->stop();
+}
+
+void EmbeddedEngine::wait() {
+    engine->wait_for_search_finished();
+}
+
+void EmbeddedEngine::ponderhit() {
+    engine->set_ponderhit(false);
+}
+
+} // namespace ChessCore
@@ -0,0 +1,65 @@
+// embedded_engine.h: Stockfish linked into the GUI process.
+// Wraps Stockfish::Engine so the GUI deals in ChessCore moves and
+// SearchInfo: no child process, no pipes and no text protocol. The NNUE
+// networks are loaded once, when the adapter is constructed.
+// Only available when the Stockfish sources are built in.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "search_info.h"
+
+namespace Stockfish {
+class Engine;
+}
+
+namespace ChessCore {
+
+class EmbeddedEngine {
+public:
+    // Called on Stockfish's search thread
+    struct Handlers {
+        std::function<void(Move best, Move ponder)> onBestMove; // best is Move::none() if there is no legal move
+        std::function<void(const SearchInfo&)> onInfo;
+    };
+
+    // True if both default network files are found next to binaryPath or in
+    // the working directory. Without them Stockfish exits on its first
+    // search, so check before choosing this engine.
+    static bool networks_available(const std::string& binaryPath);
+
+    // binaryPath is the GUI executable; networks are looked up next to it
+    EmbeddedEngine(const std::string& binaryPath, Handlers handlers);
+    ~EmbeddedEngine();
+    EmbeddedEngine(const EmbeddedEngine&) = delete;
+    EmbeddedEngine& operator=(const EmbeddedEngine&) = delete;
+
+    void set_option(const std::string& name, const std::string& value);
+
+    // Clears the hash and history tables between games
+    void new_game();
+
+    // The game so far: a start position and the moves played from it
+    void set_position(const std::string& fen, const std::vector<Move>& moves);
+
+    // Non-blocking; the result arrives through onBestMove
+    void go(const SearchLimits& limits);
+    void stop();
+    void wait();
+
+    // The expected move was played: a "go ponder" search carries on as a
+    // normal search, and answers at once if it already finished
+    void ponderhit();
+
+private:
+    std::unique_ptr<Stockfish::Engine> engine;
+    Handlers handlers;
+    Board position; // Mirror of the engine's position, to type its replies
+};
+
+} // namespace ChessCore
@@ -0,0 +1,308 @@
+// engine_client.cpp: child process plumbing and line framing for EngineClient
+
+#include "engine_client.h"
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+#include <initializer_list>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace ChessCore {
+
+// -------------------- platform backends --------------------
+#ifdef _WIN32
+
+bool EngineClient::start(const std::string& path, Handlers h) {
+    if (started)
+        return false;
+
+    SECURITY_ATTRIBUTES sa{};
+    sa.nLength = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+
+    HANDLE outRead = NULL, outWrite = NULL, inRead = NULL, inWrite = NULL;
+    if (!CreatePipe(&outRead, &outWrite, &sa, 0))
+        return false;
+    if (!CreatePipe(&inRead, &inWrite, &sa, 0)) {
+        CloseHandle(outRead); CloseHandle(outWrite);
+        return false;
+    }
+    // Our ends of the pipes must not leak into the engine
+    SetHandleInformation(outRead, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(inWrite, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA si{};
+    si.cb = sizeof(si);
+    si.hStdError = outWrite;
+    si.hStdOutput = outWrite;
+    si.hStdInput = inRead;
+    si.dwFlags |= STARTF_USESTDHANDLES;
+
+    PROCESS_INFORMATION pi{};
+    BOOL ok = CreateProcessA(path.c_str(), NULL, NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+
+    // The engine holds its own copies of the child ends now
+    CloseHandle(outWrite);
+    CloseHandle(inRead);
+    if (!ok) {
+        CloseHandle(outRead); CloseHandle(inWrite);
+        return false;
+    }
+    CloseHandle(pi.hThread);
+
+    process = pi.hProcess;
+    childIn = inWrite;
+    childOut = outRead;
+    handlers = std::move(h);
+    exited = false;
+    started = true;
+    reader = std::thread(&EngineClient::read_loop, this);
+    return true;
+}
+
+long EngineClient::read_some(char* buf, size_t size) {
+    DWORD n = 0;
+    if (!ReadFile(childOut, buf, DWORD(size), &n, NULL))
+        return -1;
+    return long(n);
+}
+
+bool EngineClient::write_all(const char* data, size_t size) {
+    while (size) {
+        DWORD n = 0;
+        if (!WriteFile(childIn, data, DWORD(size), &n, NULL))
+            return false;
+        data += n, size -= n;
+    }
+    return true;
+}
+
+bool EngineClient::wait_exit(int timeoutMs) {
+    return WaitForSingleObject(process, DWORD(timeoutMs)) == WAIT_OBJECT_0;
+}
+
+void EngineClient::kill_process() {
+    TerminateProcess(process, 1);
+    WaitForSingleObject(process, INFINITE);
+}
+
+void EngineClient::close_handles() {
+    for (void** h : { &process, &childIn, &childOut })
+        if (*h) {
+            CloseHandle(*h);
+            *h = nullptr;
+        }
+}
+
+#else
+
+bool EngineClient::start(const std::string& path, Handlers h) {
+    if (started)
+        return false;
+
+    int inPipe[2], outPipe[2];
+    if (pipe(inPipe) != 0)
+        return false;
+    if (pipe(outPipe) != 0) {
+        close(inPipe[0]); close(inPipe[1]);
+        return false;
+    }
+    // Our ends of the pipes must not leak into the engine or other children
+    fcntl(inPipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(outPipe[0], F_SETFD, FD_CLOEXEC);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, inPipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, inPipe[0]);
+    posix_spawn_file_actions_addclose(&actions, outPipe[1]);
+
+    char* argv[] = { const_cast<char*>(path.c_str()), nullptr };
+    int err = posix_spawn(&pid, path.c_str(), &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(inPipe[0]);
+    close(outPipe[1]);
+    if (err != 0) {
+        close(inPipe[1]); close(outPipe[0]);
+        pid = -1;
+        return false;
+    }
+
+    // A write to an engine that just died must fail with EPIPE rather than
+    // kill the whole program
+    std::signal(SIGPIPE, SIG_IGN);
+
+    childIn = inPipe[1];
+    childOut = outPipe[0];
+    handlers = std::move(h);
+    exited = false;
+    started = true;
+    reader = std::thread(&EngineClient::read_loop, this);
+    return true;
+}
+
+long EngineClient::read_some(char* buf, size_t size) {
+    ssize_t n;
+    do
+        n = read(childOut, buf, size);
+    while (n < 0 && errno == EINTR);
+    return long(n);
+}
+
+bool EngineClient::write_all(const char* data, size_t size) {
+    while (size) {
+        ssize_t n = write(childIn, data, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n, size -= size_t(n);
+    }
+    return true;
+}
+
+bool EngineClient::wait_exit(int timeoutMs) {
+    // Only used on shutdown, so a short sleep between checks is fine
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    do {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+}
+
+void EngineClient::kill_process() {
+    int status;
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+}
+
+void EngineClient::close_handles() {
+    if (childIn >= 0) close(childIn);
+    if (childOut >= 0) close(childOut);
+    childIn = childOut = pid = -1;
+}
+
+#endif
+
+// -------------------- common code --------------------
+void EngineClient::stop(int timeoutMs) {
+    if (!started)
+        return;
+
+    send("quit");
+    if (!wait_exit(timeoutMs))
+        kill_process();
+
+    // The reader ends when the engine's side of the pipe is closed
+    if (reader.joinable())
+        reader.join();
+    close_handles();
+    started = false;
+}
+
+bool EngineClient::send(std::string_view cmd) {
+    if (!started)
+        return false;
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::string line;
+    line.reserve(cmd.size() + 1);
+    line.append(cmd).push_back('\n');
+    return write_all(line.data(), line.size());
+}
+
+bool EngineClient::wait_ready(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(readyMutex);
+    uint64_t target = readyCount + 1;
+    lock.unlock();
+
+    if (!send("isready"))
+        return false;
+
+    lock.lock();
+    return readyCv.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                            [&] { return readyCount >= target || exited; }) && readyCount >= target;
+}
+
+void EngineClient::dispatch(std::string_view line) {
+    std::string_view token = line.substr(0, line.find(' '));
+
+    if (token == "info") {
+        if (handlers.onInfo) handlers.onInfo(line);
+    }
+    else if (token == "bestmove") {
+        if (handlers.onBestMove) handlers.onBestMove(line);
+    }
+    else if (token == "readyok") {
+        {
+            std::lock_guard<std::mutex> lock(readyMutex);
+            ++readyCount;
+        }
+        readyCv.notify_all();
+        if (handlers.onReadyOk) handlers.onReadyOk(line);
+    }
+    else if (handlers.onOther)
+        handlers.onOther(line);
+}
+
+// Blocks on the pipe and passes on every complete line. The buffer is
+// allocated once; only the unfinished tail of a read is moved to its front.
+void EngineClient::read_loop() {
+    std::unique_ptr<char[]> buf(new char[BUFFER_SIZE]);
+    size_t used = 0;
+
+    for (long n; (n = read_some(buf.get() + used, BUFFER_SIZE - used)) > 0; ) {
+        size_t end = used + size_t(n), start = 0;
+
+        for (const char* nl; (nl = static_cast<const char*>(std::memchr(buf.get() + start, '\n', end - start))); ) {
+            size_t len = size_t(nl - (buf.get() + start));
+            if (len && buf[start + len - 1] == '\r')
+                --len;
+            dispatch(std::string_view(buf.get() + start, len));
+            start += size_t(nl - (buf.get() + start)) + 1;
+        }
+
+        // A line longer than the whole buffer is passed on in pieces
+        if (start == 0 && end == BUFFER_SIZE) {
+            dispatch(std::string_view(buf.get(), end));
+            start = end;
+        }
+
+        used = end - start;
+        std::memmove(buf.get(), buf.get() + start, used);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(readyMutex);
+        exited = true;
+    }
+    readyCv.notify_all();
+    if (handlers.onExit)
+        handlers.onExit();
+}
+
+} // namespace ChessCore
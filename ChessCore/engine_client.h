@@ -0,0 +1,86 @@
+// engine_client.h: UCI engine running as a child process.
+// A reader thread blocks on the engine's stdout, cuts the stream into lines
+// inside a fixed buffer and hands each line to a callback as soon as its
+// newline arrives. Windows uses CreateProcess with anonymous pipes, other
+// platforms use posix_spawn with pipes.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace ChessCore {
+
+class EngineClient {
+public:
+    // Called on the reader thread with the line, without its line ending.
+    // The view is only valid during the call.
+    using LineHandler = std::function<void(std::string_view line)>;
+
+    struct Handlers {
+        LineHandler onInfo;     // "info ..."
+        LineHandler onBestMove; // "bestmove ..."
+        LineHandler onReadyOk;  // "readyok"
+        LineHandler onOther;    // Everything else ("id", "option", "uciok", ...)
+        std::function<void()> onExit; // The engine closed its output
+    };
+
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    EngineClient() = default;
+    ~EngineClient() { stop(); }
+    EngineClient(const EngineClient&) = delete;
+    EngineClient& operator=(const EngineClient&) = delete;
+
+    // Spawns the engine and starts the reader thread. Returns false if the
+    // process could not be started.
+    bool start(const std::string& path, Handlers handlers);
+
+    // Sends "quit", waits for the engine to exit and joins the reader. The
+    // engine is killed if it does not exit within timeoutMs.
+    void stop(int timeoutMs = 1000);
+
+    bool running() const { return started; }
+
+    // Writes one command line; the newline is added here
+    bool send(std::string_view cmd);
+
+    // Sends "isready" and blocks until the matching "readyok" or timeout
+    bool wait_ready(int timeoutMs = 5000);
+
+private:
+    void read_loop();
+    void dispatch(std::string_view line);
+    long read_some(char* buf, size_t size);
+    bool write_all(const char* data, size_t size);
+    bool wait_exit(int timeoutMs);
+    void kill_process();
+    void close_handles();
+
+    Handlers handlers;
+    std::thread reader;
+    std::mutex writeMutex;
+    bool started = false;
+
+    std::mutex readyMutex;
+    std::condition_variable readyCv;
+    uint64_t readyCount = 0;
+    bool exited = false;
+
+#ifdef _WIN32
+    void* process = nullptr;   // HANDLE
+    void* childIn = nullptr;   // HANDLE, write end of the engine's stdin
+    void* childOut = nullptr;  // HANDLE, read end of the engine's stdout
+#else
+    int pid = -1;
+    int childIn = -1;
+    int childOut = -1;
+#endif
+};
+
+} // namespace ChessCore
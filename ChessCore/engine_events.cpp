@@ -0,0 +1,42 @@
+// engine_events.cpp: engine-to-GUI event stream
+
+#include "engine_events.h"
+
+#include <thread>
+
+namespace ChessCore {
+
+void EngineEventQueue::notify() {
+    if (!signalled.exchange(true, std::memory_order_acq_rel) && wake)
+        wake();
+}
+
+bool EngineEventQueue::push_info(EngineSession::SearchId id, const SearchInfo& info) {
+    if (queue.free_slots() <= MOVE_RESERVE)
+        return false;
+    EngineEvent* e = queue.write_slot();
+    e->kind = EngineEvent::INFO;
+    e->searchId = id;
+    e->info.assign(info);
+    queue.commit();
+    notify();
+    return true;
+}
+
+bool EngineEventQueue::push_best_move(EngineSession::SearchId id, Move best, Move ponder) {
+    EngineEvent* e;
+    while ((e = queue.write_slot()) == nullptr) {
+        if (closed)
+            return false;
+        std::this_thread::yield();
+    }
+    e->kind = EngineEvent::BEST_MOVE;
+    e->searchId = id;
+    e->best = best;
+    e->ponder = ponder;
+    queue.commit();
+    notify();
+    return true;
+}
+
+} // namespace ChessCore
@@ -0,0 +1,74 @@
+// engine_events.h: engine-to-GUI event stream.
+// The engine thread (EngineClient's reader or the embedded search thread)
+// writes fixed-size records into an SpscQueue and wakes the GUI thread at
+// most once per batch: the wake callback only runs when the queue goes from
+// "drained" to "has events", so an info flood costs one window message, not
+// one per line, and no allocation at all.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#include "chess_types.h"
+#include "engine_session.h"
+#include "search_info.h"
+#include "spsc_queue.h"
+
+namespace ChessCore {
+
+struct EngineEvent {
+    enum Kind : uint8_t { INFO, BEST_MOVE };
+
+    Kind kind;
+    EngineSession::SearchId searchId; // Search the event belongs to
+    Move best, ponder;                // BEST_MOVE: from/to/promotion only
+    SearchInfoRecord info;            // INFO
+};
+
+class EngineEventQueue {
+public:
+    static constexpr size_t CAPACITY = 256;
+    // Slots info reports never take, so a bestmove always finds room
+    static constexpr size_t MOVE_RESERVE = 16;
+
+    // Called on the producer thread when the consumer should drain. Set it
+    // before the engine starts.
+    void set_wake(std::function<void()> fn) { wake = std::move(fn); }
+
+    // Producer. Info is dropped when the queue is nearly full: a newer
+    // report for the same line follows soon, and the GUI only shows the
+    // latest one anyway. Returns false if dropped.
+    bool push_info(EngineSession::SearchId id, const SearchInfo& info);
+    // Waits for room if needed, unless the queue is closed
+    bool push_best_move(EngineSession::SearchId id, Move best, Move ponder);
+
+    // Consumer: stops push_best_move() from waiting, e.g. before the GUI
+    // shuts the engine down and stops draining
+    void close() { closed = true; }
+
+    // Consumer: runs f(const EngineEvent&) for every queued event, oldest
+    // first. f must not call drain() again. Returns the number of events.
+    template<typename F>
+    size_t drain(F&& f) {
+        // Re-arm the wake-up before looking, so an event pushed while
+        // draining either is seen here or triggers a new wake-up
+        signalled.exchange(false, std::memory_order_acq_rel);
+        size_t n = 0;
+        for (const EngineEvent* e; (e = queue.front()) != nullptr; ++n) {
+            f(*e);
+            queue.pop();
+        }
+        return n;
+    }
+
+private:
+    void notify();
+
+    SpscQueue<EngineEvent, CAPACITY> queue;
+    std::atomic<bool> signalled{ false };
+    std::atomic<bool> closed{ false };
+    std::function<void()> wake;
+};
+
+} // namespace ChessCore
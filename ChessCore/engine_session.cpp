@@ -0,0 +1,54 @@
+// engine_session.cpp: search/reply pairing for UCI engines
+
+#include "engine_session.h"
+
+namespace ChessCore {
+
+EngineSession::SearchId EngineSession::begin(bool ponder) {
+    wanted = ++issued;
+    st = ponder ? PONDERING : SEARCHING;
+    return issued;
+}
+
+void EngineSession::ponderhit() {
+    if (st == PONDERING)
+        st = SEARCHING;
+}
+
+bool EngineSession::stop() {
+    if (st == PONDERING)
+        return cancel();
+    if (st != SEARCHING)
+        return false;
+    st = STOPPING;
+    return true;
+}
+
+bool EngineSession::cancel() {
+    wanted = NO_SEARCH;
+    if (st == IDLE || st == STOPPING)
+        return false;
+    st = STOPPING;
+    return true;
+}
+
+void EngineSession::reset() {
+    st = IDLE;
+    issued = wanted = NO_SEARCH;
+    replies = NO_SEARCH;
+}
+
+bool EngineSession::accept(SearchId id) {
+    // Engines hold a ponder search's reply until "ponderhit" or "stop"; one
+    // arriving earlier is for a position that has not happened, so it ends
+    // the search without being played
+    bool play = id == wanted && st != PONDERING;
+    if (id == wanted)
+        wanted = NO_SEARCH;
+    // The last outstanding reply has arrived
+    if (id == issued)
+        st = IDLE;
+    return play;
+}
+
+} // namespace ChessCore
@@ -0,0 +1,67 @@
+// engine_session.h: bookkeeping for the searches a GUI has asked an engine for.
+// UCI engines answer every "go" with exactly one "bestmove", in order, even
+// when the search is stopped. Numbering searches as they are started and
+// replies as they arrive therefore pairs each reply with its search, so a
+// reply to a search the GUI has since abandoned (takeback, new game, wrong
+// ponder guess) is recognised and dropped without waiting for it.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ChessCore {
+
+class EngineSession {
+public:
+    using SearchId = uint32_t;
+    static constexpr SearchId NO_SEARCH = 0;
+
+    enum State : uint8_t {
+        IDLE,      // No search running
+        SEARCHING, // The engine is thinking about a move the GUI will play
+        PONDERING, // The engine is thinking on the opponent's time
+        STOPPING   // "stop" was sent and the reply is still to come
+    };
+
+    // All members except next_reply_id() and pending_reply_id() belong to
+    // the GUI thread
+
+    State state() const { return st; }
+    // The search started last; its info is the one worth showing
+    SearchId current() const { return issued; }
+    // A move is expected from the current search
+    bool awaiting_move() const { return wanted != NO_SEARCH && st != PONDERING; }
+
+    // Records a "go" that was just sent and returns its id. Any earlier
+    // search still running is abandoned.
+    SearchId begin(bool ponder);
+    // The ponder guess was right: the current search now plays for real
+    void ponderhit();
+    // "Move now": the caller sends "stop" and the reply is still played.
+    // A ponder search has nothing to play, so it is cancelled instead.
+    // Returns false if no search is running.
+    bool stop();
+    // The caller sends "stop" and the reply will be dropped. Returns false
+    // if no search is running.
+    bool cancel();
+    // Forgets everything, e.g. after the engine was restarted
+    void reset();
+
+    // Engine thread: the id of the search the reply being delivered answers.
+    // Call once per "bestmove", in arrival order.
+    SearchId next_reply_id() { return ++replies; }
+    // Engine thread: the search that "info" lines arriving now belong to
+    SearchId pending_reply_id() const { return replies + 1; }
+
+    // GUI thread: true if the reply with this id should be played
+    bool accept(SearchId id);
+
+private:
+    State st = IDLE;
+    SearchId issued = NO_SEARCH; // Last search started
+    SearchId wanted = NO_SEARCH; // Search whose reply will be played
+    std::atomic<SearchId> replies{ NO_SEARCH };
+};
+
+} // namespace ChessCore
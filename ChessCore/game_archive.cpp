@@ -0,0 +1,525 @@
+// game_archive.cpp: binary game records, their index and PGN export
+
+#include "game_archive.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+
+#include "board.h"
+#include "legal_moves.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace ChessCore {
+
+namespace {
+
+constexpr char DataMagic[8] = { 'C', 'C', 'G', 'A', 'M', 'E', 'S', 0 };
+constexpr char IndexMagic[8] = { 'C', 'C', 'G', 'I', 'N', 'D', 'E', 'X' };
+constexpr uint32_t Version = 1;
+constexpr uint64_t FILE_HEADER_SIZE = 16; // Magic, version, padding
+constexpr uint32_t RECORD_MAGIC = 0x43524743; // "CGRC"
+
+enum RecordFlags : uint8_t { HAS_EVALS = 1, HAS_CLOCKS = 2 };
+
+// Fixed part of a record, stored as is (little-endian on every target the
+// GUIs build for)
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t size; // Whole record, header included
+    int64_t startTime;
+    int32_t clockBaseMs;
+    int32_t clockIncMs;
+    uint16_t plies;
+    uint8_t result;
+    uint8_t flags;
+    uint8_t whiteLen;
+    uint8_t blackLen;
+    uint16_t fenLen;
+};
+static_assert(sizeof(RecordHeader) == 32, "record header layout");
+
+void write_file_header(std::fstream& f, const char* magic) {
+    char header[FILE_HEADER_SIZE] = {};
+    std::memcpy(header, magic, 8);
+    std::memcpy(header + 8, &Version, sizeof(Version));
+    f.write(header, sizeof(header));
+}
+
+bool check_file_header(std::fstream& f, const char* magic) {
+    char header[FILE_HEADER_SIZE];
+    uint32_t version;
+    f.seekg(0);
+    if (!f.read(header, sizeof(header)))
+        return false;
+    std::memcpy(&version, header + 8, sizeof(version));
+    return std::memcmp(header, magic, 8) == 0 && version == Version;
+}
+
+// Opens path for reading and writing, creating it with a file header first
+bool open_file(std::fstream& f, const std::string& path, const char* magic) {
+    f.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!f.is_open()) {
+        f.clear();
+        f.open(path, std::ios::out | std::ios::binary);
+        if (!f.is_open())
+            return false;
+        write_file_header(f, magic);
+        f.close();
+        f.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    }
+    return f.is_open() && check_file_header(f, magic);
+}
+
+uint64_t file_size(std::fstream& f) {
+    f.clear();
+    f.seekg(0, std::ios::end);
+    return uint64_t(f.tellg());
+}
+
+// Exclusive lock on "<archive>.lock" for as long as the object lives.
+// Waits for another process holding it; the lock goes with the handle, so a
+// process that dies while appending does not leave the archive locked.
+class ArchiveLock {
+public:
+    explicit ArchiveLock(const std::string& path);
+    ~ArchiveLock();
+    ArchiveLock(const ArchiveLock&) = delete;
+    ArchiveLock& operator=(const ArchiveLock&) = delete;
+
+    bool locked() const { return isLocked; }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+    bool isLocked = false;
+};
+
+#ifdef _WIN32
+
+ArchiveLock::ArchiveLock(const std::string& path) {
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                       OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    OVERLAPPED at{};
+    isLocked = file != INVALID_HANDLE_VALUE && LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &at);
+}
+
+ArchiveLock::~ArchiveLock() {
+    if (isLocked) {
+        OVERLAPPED at{};
+        UnlockFileEx(file, 0, 1, 0, &at);
+    }
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+}
+
+#else
+
+ArchiveLock::ArchiveLock(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return;
+    int r;
+    while ((r = flock(fd, LOCK_EX)) != 0 && errno == EINTR) {
+    }
+    isLocked = r == 0;
+}
+
+ArchiveLock::~ArchiveLock() {
+    if (isLocked)
+        flock(fd, LOCK_UN);
+    if (fd >= 0)
+        ::close(fd);
+}
+
+#endif
+
+template<typename T>
+void put(std::vector<char>& buf, const T* values, size_t n) {
+    const char* p = reinterpret_cast<const char*>(values);
+    buf.insert(buf.end(), p, p + n * sizeof(T));
+}
+
+// -------------------- SAN --------------------
+
+std::string to_san(const Board& b, Move m) {
+    Square from = m.from_sq(), to = m.to_sq();
+    if (m.type_of() == CASTLING)
+        return file_of(to) == FILE_G ? "O-O" : "O-O-O";
+
+    PieceType pt = type_of(b.piece_on(from));
+    bool capture = !b.empty(to) || m.type_of() == EN_PASSANT;
+    std::string s;
+
+    if (pt != PAWN) {
+        s += " PNBRQK"[pt];
+        // Another piece of the same kind that can go to the same square
+        bool ambiguous = false, sameFile = false, sameRank = false;
+        for (Move other : MoveList(b))
+            if (other.to_sq() == to && other.from_sq() != from && type_of(b.piece_on(other.from_sq())) == pt) {
+                ambiguous = true;
+                sameFile |= file_of(other.from_sq()) == file_of(from);
+                sameRank |= rank_of(other.from_sq()) == rank_of(from);
+            }
+        if (ambiguous && (!sameFile || sameRank))
+            s += char('a' + file_of(from));
+        if (ambiguous && sameFile)
+            s += char('1' + rank_of(from));
+    }
+    else if (capture)
+        s += char('a' + file_of(from));
+
+    if (capture)
+        s += 'x';
+    s += char('a' + file_of(to));
+    s += char('1' + rank_of(to));
+    if (m.type_of() == PROMOTION) {
+        s += '=';
+        s += " PNBRQK"[m.promotion_type()];
+    }
+    return s;
+}
+
+// Unix time -> "YYYY.MM.DD" (UTC), without the non-reentrant gmtime()
+std::string pgn_date(int64_t t) {
+    if (t <= 0)
+        return "????.??.??";
+    int64_t z = t / 86400 + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int d = int(doy - (153 * mp + 2) / 5 + 1);
+    int m = int(mp < 10 ? mp + 3 : mp - 9);
+    int y = int(yoe + era * 400 + (m <= 2));
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%04d.%02d.%02d", y, m, d);
+    return buf;
+}
+
+const char* result_text(GameResult r) {
+    static const char* Text[] = { "*", "1-0", "0-1", "1/2-1/2" };
+    return Text[r];
+}
+
+} // namespace
+
+void ArchivedGame::clear() {
+    white = "White";
+    black = "Black";
+    fen.clear();
+    startTime = 0;
+    result = RESULT_UNFINISHED;
+    clockBaseMs = clockIncMs = 0;
+    moves.clear();
+    evals.clear();
+    clocksMs.clear();
+}
+
+int16_t ArchivedGame::to_eval(int score, bool isMate, Color sideToMove) {
+    // Mates are mapped from the side to move first: "mate 0" means the side
+    // to move is mated, whichever colour it is
+    int cp = !isMate ? std::clamp(score, -(MATE_EVAL - 1000), MATE_EVAL - 1000)
+           : score > 0 ? MATE_EVAL - score : -MATE_EVAL - score;
+    return int16_t(sideToMove == WHITE ? cp : -cp);
+}
+
+// -------------------- archive --------------------
+
+bool GameArchive::open(const std::string& path) {
+    close();
+    // rebuild_index() may write to the index. Without a lock file (a
+    // read-only folder) the archive can still be read, just not appended to.
+    ArchiveLock lock(path + ".lock");
+    if (!open_file(data, path, DataMagic) || !open_index(path + ".idx", false)) {
+        close();
+        return false;
+    }
+    archivePath = path;
+    return rebuild_index(path + ".idx");
+}
+
+void GameArchive::close() {
+    data.close();
+    index.close();
+    data.clear();
+    index.clear();
+    count = 0;
+    dataEnd = 0;
+    archivePath.clear();
+}
+
+// Opens the index; a damaged one, or one to rewrite, starts over empty
+bool GameArchive::open_index(const std::string& indexPath, bool truncate) {
+    index.close();
+    index.clear();
+    if (truncate || !open_file(index, indexPath, IndexMagic)) {
+        index.close();
+        index.clear();
+        index.open(indexPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        write_file_header(index, IndexMagic);
+        index.close();
+        if (!open_file(index, indexPath, IndexMagic))
+            return false;
+    }
+    count = size_t((file_size(index) - FILE_HEADER_SIZE) / sizeof(uint64_t));
+    return true;
+}
+
+// Returns the end of the record at 'offset', or 0 if there is no whole
+// record there
+uint64_t GameArchive::record_end(uint64_t offset, uint64_t end) {
+    RecordHeader h;
+    data.clear();
+    data.seekg(offset);
+    if (offset < FILE_HEADER_SIZE || offset + sizeof(h) > end || !data.read(reinterpret_cast<char*>(&h), sizeof(h))
+        || h.magic != RECORD_MAGIC || h.size < sizeof(h) || offset + h.size > end)
+        return 0;
+    return offset + h.size;
+}
+
+// Brings the index in line with the data file: entries for records lost
+// from the end of the data file are dropped, records written after the last
+// indexed one are added. A torn record at the end (crash while appending)
+// stays unindexed and is overwritten by the next append.
+bool GameArchive::rebuild_index(const std::string& indexPath) {
+    uint64_t end = file_size(data);
+    dataEnd = FILE_HEADER_SIZE;
+    if (count > 0) {
+        uint64_t last;
+        index.clear();
+        index.seekg(FILE_HEADER_SIZE + (count - 1) * sizeof(uint64_t));
+        if (!index.read(reinterpret_cast<char*>(&last), sizeof(last)))
+            return false;
+        dataEnd = record_end(last, end);
+    }
+    if (count > 0 && dataEnd == 0) {
+        // Rare: read the whole index back, drop the stale tail and rewrite it
+        std::vector<uint64_t> offsets(count);
+        index.clear();
+        index.seekg(FILE_HEADER_SIZE);
+        if (!index.read(reinterpret_cast<char*>(offsets.data()), std::streamsize(count * sizeof(uint64_t))))
+            return false;
+        size_t valid = count - 1;
+        while (valid > 0 && (dataEnd = record_end(offsets[valid - 1], end)) == 0)
+            --valid;
+        if (valid == 0)
+            dataEnd = FILE_HEADER_SIZE;
+        if (!open_index(indexPath, true))
+            return false;
+        index.seekp(0, std::ios::end);
+        index.write(reinterpret_cast<const char*>(offsets.data()), std::streamsize(valid * sizeof(uint64_t)));
+        count = valid;
+    }
+
+    index.clear();
+    index.seekp(0, std::ios::end);
+    for (uint64_t next; (next = record_end(dataEnd, end)) != 0; dataEnd = next) {
+        index.write(reinterpret_cast<const char*>(&dataEnd), sizeof(dataEnd));
+        ++count;
+    }
+    data.clear();
+    index.flush();
+    return bool(index);
+}
+
+bool GameArchive::append(const ArchivedGame& game) {
+    if (!is_open())
+        return false;
+
+    size_t plies = std::min<size_t>(game.moves.size(), UINT16_MAX);
+    bool hasEvals = game.evals.size() >= plies && plies > 0;
+    bool hasClocks = game.clocksMs.size() >= plies && plies > 0;
+
+    RecordHeader h{};
+    h.magic = RECORD_MAGIC;
+    h.startTime = game.startTime;
+    h.clockBaseMs = game.clockBaseMs;
+    h.clockIncMs = game.clockIncMs;
+    h.plies = uint16_t(plies);
+    h.result = game.result;
+    h.flags = uint8_t((hasEvals ? HAS_EVALS : 0) | (hasClocks ? HAS_CLOCKS : 0));
+    h.whiteLen = uint8_t(std::min<size_t>(game.white.size(), UINT8_MAX));
+    h.blackLen = uint8_t(std::min<size_t>(game.black.size(), UINT8_MAX));
+    h.fenLen = uint16_t(std::min<size_t>(game.fen.size(), UINT16_MAX));
+
+    buffer.resize(sizeof(h));
+    put(buffer, game.white.data(), h.whiteLen);
+    put(buffer, game.black.data(), h.blackLen);
+    put(buffer, game.fen.data(), h.fenLen);
+    for (size_t i = 0; i < plies; ++i) {
+        uint16_t raw = game.moves[i].raw();
+        put(buffer, &raw, 1);
+    }
+    if (hasEvals)
+        put(buffer, game.evals.data(), plies);
+    if (hasClocks)
+        put(buffer, game.clocksMs.data(), plies);
+    h.size = uint32_t(buffer.size());
+    std::memcpy(buffer.data(), &h, sizeof(h));
+
+    // Another process may have appended since this one last looked: pick
+    // up its index entries and the data file's end under the lock, so the
+    // record goes after them
+    ArchiveLock lock(archivePath + ".lock");
+    if (!lock.locked())
+        return false;
+    count = size_t((file_size(index) - FILE_HEADER_SIZE) / sizeof(uint64_t));
+    if (!rebuild_index(archivePath + ".idx"))
+        return false;
+
+    uint64_t offset = dataEnd;
+    data.clear();
+    data.seekp(std::streamoff(offset));
+    if (!data.write(buffer.data(), std::streamsize(buffer.size())) || !data.flush())
+        return false;
+
+    index.clear();
+    index.seekp(0, std::ios::end);
+    if (!index.write(reinterpret_cast<const char*>(&offset), sizeof(offset)) || !index.flush())
+        return false;
+    dataEnd += buffer.size();
+    ++count;
+    return true;
+}
+
+bool GameArchive::read(size_t n, ArchivedGame& game) {
+    if (n >= count)
+        return false;
+    uint64_t offset;
+    index.clear();
+    index.seekg(FILE_HEADER_SIZE + n * sizeof(uint64_t));
+    if (!index.read(reinterpret_cast<char*>(&offset), sizeof(offset)))
+        return false;
+    return read_record(offset, game);
+}
+
+bool GameArchive::read_record(uint64_t offset, ArchivedGame& game) {
+    RecordHeader h;
+    data.clear();
+    data.seekg(offset);
+    if (!data.read(reinterpret_cast<char*>(&h), sizeof(h)) || h.magic != RECORD_MAGIC || h.size < sizeof(h))
+        return false;
+    buffer.resize(h.size - sizeof(h));
+    if (!data.read(buffer.data(), std::streamsize(buffer.size())))
+        return false;
+
+    size_t plies = h.plies;
+    size_t need = size_t(h.whiteLen) + h.blackLen + h.fenLen + plies * sizeof(uint16_t)
+                + (h.flags & HAS_EVALS ? plies * sizeof(int16_t) : 0)
+                + (h.flags & HAS_CLOCKS ? plies * sizeof(int32_t) : 0);
+    if (need > buffer.size())
+        return false;
+
+    const char* p = buffer.data();
+    game.white.assign(p, h.whiteLen); p += h.whiteLen;
+    game.black.assign(p, h.blackLen); p += h.blackLen;
+    game.fen.assign(p, h.fenLen); p += h.fenLen;
+    game.startTime = h.startTime;
+    game.result = GameResult(std::min<uint8_t>(h.result, RESULT_DRAW));
+    game.clockBaseMs = h.clockBaseMs;
+    game.clockIncMs = h.clockIncMs;
+
+    game.moves.resize(plies);
+    for (size_t i = 0; i < plies; ++i, p += sizeof(uint16_t)) {
+        uint16_t raw;
+        std::memcpy(&raw, p, sizeof(raw));
+        game.moves[i] = Move(raw);
+    }
+    game.evals.resize(h.flags & HAS_EVALS ? plies : 0);
+    std::memcpy(game.evals.data(), p, game.evals.size() * sizeof(int16_t));
+    p += game.evals.size() * sizeof(int16_t);
+    game.clocksMs.resize(h.flags & HAS_CLOCKS ? plies : 0);
+    std::memcpy(game.clocksMs.data(), p, game.clocksMs.size() * sizeof(int32_t));
+
+    return true;
+}
+
+// -------------------- PGN --------------------
+
+void write_pgn(std::ostream& out, const ArchivedGame& game, size_t round) {
+    out << "[Event \"Casual game\"]\n"
+        << "[Site \"?\"]\n"
+        << "[Date \"" << pgn_date(game.startTime) << "\"]\n"
+        << "[Round \"" << round << "\"]\n"
+        << "[White \"" << game.white << "\"]\n"
+        << "[Black \"" << game.black << "\"]\n"
+        << "[Result \"" << result_text(game.result) << "\"]\n";
+    if (!game.fen.empty())
+        out << "[SetUp \"1\"]\n[FEN \"" << game.fen << "\"]\n";
+    if (game.clockBaseMs > 0)
+        out << "[TimeControl \"" << game.clockBaseMs / 1000 << "+" << game.clockIncMs / 1000 << "\"]\n";
+    out << "\n";
+
+    Board b;
+    b.set(game.fen.empty() ? StartFEN : game.fen);
+    std::string line;
+    auto emit = [&](const std::string& token) {
+        if (!line.empty() && line.size() + 1 + token.size() > 79) {
+            out << line << "\n";
+            line.clear();
+        }
+        if (!line.empty())
+            line += ' ';
+        line += token;
+    };
+
+    for (size_t i = 0; i < game.moves.size(); ++i) {
+        Move m = game.moves[i];
+        if (!MoveList(b).contains(m))
+            break; // Damaged record: export what is legal
+
+        if (b.side_to_move() == WHITE || i == 0)
+            emit(std::to_string(b.game_ply() / 2 + 1) + (b.side_to_move() == WHITE ? "." : "..."));
+        std::string san = to_san(b, m);
+        b.do_move(m);
+        if (b.in_check())
+            san += MoveList(b).empty() ? '#' : '+';
+        emit(san);
+
+        bool hasEval = i < game.evals.size() && game.evals[i] != ArchivedGame::NO_EVAL;
+        bool hasClock = i < game.clocksMs.size();
+        if (hasEval || hasClock) {
+            char comment[64] = "{";
+            size_t len = 1;
+            if (hasEval) {
+                int e = game.evals[i];
+                if (std::abs(e) > ArchivedGame::MATE_EVAL - 1000)
+                    len += std::snprintf(comment + len, sizeof(comment) - len, " [%%eval #%d]",
+                                         e > 0 ? ArchivedGame::MATE_EVAL - e : -(ArchivedGame::MATE_EVAL + e));
+                else
+                    len += std::snprintf(comment + len, sizeof(comment) - len, " [%%eval %.2f]", e / 100.0);
+            }
+            if (hasClock) {
+                int s = std::max(0, game.clocksMs[i]) / 1000;
+                len += std::snprintf(comment + len, sizeof(comment) - len, " [%%clk %d:%02d:%02d]", s / 3600, s / 60 % 60, s % 60);
+            }
+            std::snprintf(comment + len, sizeof(comment) - len, " }");
+            emit(comment);
+        }
+    }
+    emit(result_text(game.result));
+    out << line << "\n\n";
+}
+
+} // namespace ChessCore
@@ -0,0 +1,102 @@
+// game_archive.h: append-only binary archive of played games.
+// Each game is one record: a fixed header, the player names, an optional
+// start FEN, the moves as 16-bit Move values and, if recorded, one eval
+// and one clock reading per move. Records are only ever appended to the
+// data file; a companion index file ("<path>.idx") holds the 64-bit offset
+// of every record, so game N is one index read and one record read away
+// and millions of games can be scanned without parsing any text. PGN is an
+// export format only.
+//
+// Data file: "CCGAMES" + version, then the records back to back.
+// Index file: "CCGINDEX" + version, then one uint64 offset per game. An
+// index that is missing or shorter than the data file (a crash between
+// the two appends) is completed by walking the records after the last
+// indexed one; entries pointing past a truncated data file are dropped.
+//
+// Several processes may append to one archive (ChessAI and Chess2Player
+// share ChessGames.bin): open() and append() hold an exclusive lock on
+// "<path>.lock" (LockFileEx / flock), and append() re-reads where the files
+// end under it, so records never land on top of each other.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "chess_types.h"
+
+namespace ChessCore {
+
+enum GameResult : uint8_t { RESULT_UNFINISHED, RESULT_WHITE_WINS, RESULT_BLACK_WINS, RESULT_DRAW };
+
+struct ArchivedGame {
+    static constexpr int16_t NO_EVAL = INT16_MIN;
+    static constexpr int MATE_EVAL = 32000; // Mate in n: +-(MATE_EVAL - n)
+
+    std::string white = "White";
+    std::string black = "Black";
+    std::string fen;     // Start position; empty for the standard one
+    int64_t startTime = 0; // Unix time in seconds
+    GameResult result = RESULT_UNFINISHED;
+    int clockBaseMs = 0; // 0: untimed
+    int clockIncMs = 0;
+
+    std::vector<Move> moves;
+    // Either empty or one entry per move:
+    std::vector<int16_t> evals;   // After the move, centipawns from White's side, or NO_EVAL
+    std::vector<int32_t> clocksMs; // The mover's time left after the move
+
+    void clear();
+
+    // An evals entry from a UCI score (centipawns or moves to mate) of the
+    // side to move
+    static int16_t to_eval(int score, bool isMate, Color sideToMove);
+};
+
+class GameArchive {
+public:
+    GameArchive() = default;
+    GameArchive(const GameArchive&) = delete;
+    GameArchive& operator=(const GameArchive&) = delete;
+
+    // Opens or creates the archive and its index. Returns false if the
+    // files cannot be opened or the data file is not an archive. Only the
+    // last index entry is checked, so opening is cheap and writers sharing
+    // a file can open, append and close for each game.
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return data.is_open(); }
+
+    size_t size() const { return count; }
+
+    // Appends a game and its index entry, flushed to disk, after any games
+    // other processes appended since open(). False if the lock file cannot
+    // be created.
+    bool append(const ArchivedGame& game);
+    // Reads game n (0-based). 'game' keeps its buffers between calls, so a
+    // scan over the archive does not allocate per game.
+    bool read(size_t n, ArchivedGame& game);
+
+private:
+    bool read_record(uint64_t offset, ArchivedGame& game);
+    bool open_index(const std::string& indexPath, bool truncate);
+    uint64_t record_end(uint64_t offset, uint64_t end);
+    bool rebuild_index(const std::string& indexPath);
+
+    std::string archivePath;
+    std::fstream data;
+    std::fstream index;
+    size_t count = 0;
+    uint64_t dataEnd = 0; // End of the last whole record, as of the last sync
+    std::vector<char> buffer;
+};
+
+// Writes one game as PGN; 'round' goes into the Round tag. Moves are
+// converted to SAN by replaying them, evals and clocks become the usual
+// [%eval] / [%clk] comments. Needs init() to have run.
+void write_pgn(std::ostream& out, const ArchivedGame& game, size_t round);
+
+} // namespace ChessCore
@@ -0,0 +1,58 @@
+// game_clock.cpp: chess clock bookkeeping
+
+#include "game_clock.h"
+
+#include <algorithm>
+#include <initializer_list>
+
+namespace ChessCore {
+
+void GameClock::reset(int baseMs, int increment) {
+    timeLeft[WHITE] = timeLeft[BLACK] = baseMs;
+    incMs = increment;
+    sideRunning = WHITE;
+    runningFlag = false;
+}
+
+int GameClock::elapsed_ms() const {
+    return int(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - turnStart).count());
+}
+
+void GameClock::start(Color c) {
+    stop();
+    sideRunning = c;
+    runningFlag = true;
+    turnStart = Clock::now();
+}
+
+void GameClock::press() {
+    if (!runningFlag)
+        return;
+    Color mover = sideRunning;
+    stop();
+    timeLeft[mover] += incMs;
+    start(~mover);
+}
+
+void GameClock::stop() {
+    if (!runningFlag)
+        return;
+    timeLeft[sideRunning] = remaining(sideRunning);
+    runningFlag = false;
+}
+
+int GameClock::remaining(Color c) const {
+    int left = timeLeft[c];
+    if (runningFlag && c == sideRunning)
+        left -= elapsed_ms();
+    return std::max(left, 0);
+}
+
+void GameClock::fill(SearchLimits& limits) const {
+    for (Color c : { WHITE, BLACK }) {
+        limits.timeMs[c] = std::max(remaining(c), 1); // 0 would mean "no clock" to the engine
+        limits.incMs[c] = incMs;
+    }
+}
+
+} // namespace ChessCore
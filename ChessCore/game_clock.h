@@ -0,0 +1,53 @@
+// game_clock.h: two-sided chess clock with Fischer increment.
+// Times are in milliseconds. The clock of the side to move runs from
+// start() or the last press(); it fills the wtime/btime/winc/binc fields of
+// SearchLimits so the engine's own time management decides how long to
+// think.
+
+#pragma once
+
+#include <chrono>
+
+#include "chess_types.h"
+#include "search_info.h"
+
+namespace ChessCore {
+
+class GameClock {
+public:
+    GameClock() { reset(5 * 60 * 1000, 0); }
+
+    // Both sides get baseMs, plus incMs after each of their moves
+    void reset(int baseMs, int incMs);
+
+    // Starts the clock of c. The other clock is stopped.
+    void start(Color c);
+    // The running side has moved: bank its time, add its increment and
+    // start the opponent's clock
+    void press();
+    void stop();
+
+    Color running_side() const { return sideRunning; }
+    bool is_running() const { return runningFlag; }
+    int increment() const { return incMs; }
+
+    // Time left for c, counting the current turn if c's clock is running.
+    // Never negative.
+    int remaining(Color c) const;
+    bool flagged(Color c) const { return remaining(c) == 0; }
+
+    void fill(SearchLimits& limits) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    int elapsed_ms() const;
+
+    int timeLeft[COLOR_NB];
+    int incMs;
+    Color sideRunning = WHITE;
+    bool runningFlag = false;
+    Clock::time_point turnStart;
+};
+
+} // namespace ChessCore
@@ -0,0 +1,130 @@
+// game_review.cpp: game review bookkeeping and move classification
+
+#include "game_review.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "legal_moves.h"
+
+namespace ChessCore {
+
+namespace {
+
+// Chances of the side with this score, from -1 (lost) to 1 (won)
+double winning_chances(int cp) {
+    cp = std::clamp(cp, -1000, 1000);
+    return 2.0 / (1.0 + std::exp(-0.00368208 * cp)) - 1.0;
+}
+
+// "+0.31", "#3" (white mates in 3), "#-2"
+std::string format_eval(int cp) {
+    char buf[16];
+    if (cp >= GameReview::MATE_CP - 500)
+        std::snprintf(buf, sizeof(buf), "#%d", GameReview::MATE_CP - cp);
+    else if (cp <= -GameReview::MATE_CP + 500)
+        std::snprintf(buf, sizeof(buf), "#-%d", GameReview::MATE_CP + cp);
+    else
+        std::snprintf(buf, sizeof(buf), "%+.2f", cp / 100.0);
+    return buf;
+}
+
+} // namespace
+
+void GameReview::reset(const std::string& fen, const std::vector<Move>& moves) {
+    startFen = fen;
+    gameMoves = moves;
+    evals.assign(moves.size() + 1, PositionEval());
+    known.assign(moves.size() + 1, 0);
+    sideToMove.assign(moves.size() + 1, WHITE);
+
+    Board b;
+    b.set(fen);
+    startPly = b.game_ply();
+    for (size_t ply = 0; ply <= moves.size(); ++ply) {
+        sideToMove[ply] = uint8_t(b.side_to_move());
+        if (MoveList(b).empty()) {
+            // Mated (mate in 0) or stalemate
+            evals[ply].isMate = b.in_check();
+            known[ply] = 1;
+        }
+        if (ply < moves.size())
+            b.do_move(moves[ply]);
+    }
+}
+
+std::vector<size_t> GameReview::schedule(int engine, int engines) const {
+    size_t n = evals.size();
+    size_t lo = n * engine / engines, hi = n * (engine + 1) / engines;
+    std::vector<size_t> plies;
+    for (size_t ply = hi; ply-- > lo; )
+        if (!known[ply])
+            plies.push_back(ply);
+    return plies;
+}
+
+void GameReview::set_eval(size_t ply, const PositionEval& eval) {
+    evals[ply] = eval;
+    known[ply] = 1;
+}
+
+bool GameReview::done() const {
+    return std::all_of(known.begin(), known.end(), [](uint8_t k) { return k != 0; });
+}
+
+int GameReview::white_cp(size_t ply) const {
+    const PositionEval& e = evals[ply];
+    int cp = !e.isMate ? e.score : e.score > 0 ? MATE_CP - e.score : -MATE_CP - e.score;
+    return sideToMove[ply] == WHITE ? cp : -cp;
+}
+
+std::vector<MoveReview> GameReview::review() const {
+    std::vector<MoveReview> result;
+    Board b;
+    b.set(startFen);
+    for (size_t ply = 0; ply < gameMoves.size(); ++ply) {
+        MoveReview r;
+        r.played = gameMoves[ply];
+        r.side = Color(sideToMove[ply]);
+        r.evalBefore = white_cp(ply);
+        r.evalAfter = white_cp(ply + 1);
+
+        // The engine's move as the legal move it stands for (castling, en passant)
+        Move best = evals[ply].best;
+        r.best = best ? MoveList(b).find(best.from_sq(), best.to_sq(),
+                                         best.type_of() == PROMOTION ? best.promotion_type() : QUEEN)
+                      : Move::none();
+
+        int sign = r.side == WHITE ? 1 : -1;
+        int before = std::clamp(sign * r.evalBefore, -1000, 1000);
+        int after = std::clamp(sign * r.evalAfter, -1000, 1000);
+        r.loss = std::max(0, before - after);
+
+        double drop = winning_chances(before) - winning_chances(after);
+        r.quality = r.played == r.best ? MQ_BEST
+                  : drop >= 0.3        ? MQ_BLUNDER
+                  : drop >= 0.2        ? MQ_MISTAKE
+                  : drop >= 0.1        ? MQ_INACCURACY
+                                       : MQ_GOOD;
+        result.push_back(r);
+        b.do_move(gameMoves[ply]);
+    }
+    return result;
+}
+
+const char* GameReview::quality_name(MoveQuality q) {
+    static const char* Names[MQ_NB] = { "best", "good", "inaccuracy", "mistake", "blunder" };
+    return Names[q];
+}
+
+std::string GameReview::report_line(size_t ply, const MoveReview& r) const {
+    char moveNo[32], line[128];
+    std::snprintf(moveNo, sizeof(moveNo), "%zu%s", (startPly + ply) / 2 + 1, r.side == WHITE ? "." : "...");
+    std::snprintf(line, sizeof(line), "%7s %-6s best %-6s %7s -> %-7s loss %4d  %s", moveNo, Board::uci(r.played).c_str(),
+                  r.best ? Board::uci(r.best).c_str() : "-", format_eval(r.evalBefore).c_str(),
+                  format_eval(r.evalAfter).c_str(), r.loss, quality_name(r.quality));
+    return line;
+}
+
+} // namespace ChessCore
@@ -0,0 +1,86 @@
+// game_review.h: whole-game analysis and move classification.
+// A game of n moves has n + 1 positions to evaluate. They are handed out in
+// contiguous blocks, one per engine, and each block is walked from its last
+// position to its first: a position's search then finds the positions after
+// it already in the engine's transposition table, so the deeper results of
+// the endgame carry back to the earlier moves. With a single engine the
+// whole game is analysed last-to-first; that engine's own threads do the
+// parallel work. Engines are not part of this class: the caller runs the
+// searches and stores their results with set_eval(), from any thread.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+namespace ChessCore {
+
+// Result of the search of one position. Scores are from the side to move.
+struct PositionEval {
+    Move best = Move::none();
+    int score = 0;        // Centipawns, or moves to mate (negative if being mated)
+    bool isMate = false;
+    int depth = 0;
+};
+
+enum MoveQuality : uint8_t { MQ_BEST, MQ_GOOD, MQ_INACCURACY, MQ_MISTAKE, MQ_BLUNDER, MQ_NB };
+
+struct MoveReview {
+    Move played;
+    Move best;         // Engine's choice in the position before the move
+    Color side;
+    int evalBefore;    // White's point of view, centipawns; mates are +-MATE_CP
+    int evalAfter;
+    int loss;          // Centipawns given away by the mover, scores capped at +-1000
+    MoveQuality quality;
+};
+
+class GameReview {
+public:
+    // Mate scores in the centipawn scale, minus the moves to mate
+    static constexpr int MATE_CP = 10000;
+
+    // The game to review. Positions without legal moves (mate, stalemate)
+    // are scored here and need no search.
+    void reset(const std::string& fen, const std::vector<Move>& moves);
+
+    size_t positions() const { return evals.size(); }
+    // The moves leading from the start position to position 'ply'
+    std::vector<Move> moves_to(size_t ply) const {
+        return std::vector<Move>(gameMoves.begin(), gameMoves.begin() + ply);
+    }
+
+    // Positions still to search for one of 'engines' engines, in the order
+    // to search them: one contiguous block per engine, last position first
+    std::vector<size_t> schedule(int engine, int engines) const;
+
+    // Distinct plies may be set from different threads at the same time
+    void set_eval(size_t ply, const PositionEval& eval);
+    bool done() const;
+
+    // Eval, best move and classification of every move. Moves are judged
+    // by the drop of the mover's winning chances (-1..1 from the score) as
+    // in common review tools: 0.1 inaccuracy, 0.2 mistake, 0.3 blunder, so
+    // a lost position is not full of blunders. Needs done().
+    std::vector<MoveReview> review() const;
+
+    static const char* quality_name(MoveQuality q);
+    // One line of a text report: "12... d7d5   best c7c5   +0.31 -> +1.02   loss   71  inaccuracy".
+    // Moves are numbered from the start position's move number and side.
+    std::string report_line(size_t ply, const MoveReview& r) const;
+
+private:
+    int white_cp(size_t ply) const;
+
+    std::string startFen;
+    int startPly = 0; // Board::game_ply() of the start position
+    std::vector<Move> gameMoves;
+    std::vector<PositionEval> evals;
+    std::vector<uint8_t> known;   // 1 once evals[ply] is set; not vector<bool>, for concurrent set_eval()
+    std::vector<uint8_t> sideToMove;
+};
+
+} // namespace ChessCore
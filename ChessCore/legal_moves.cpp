@@ -0,0 +1,168 @@
+// legal_moves.cpp: legal move generator using checker and pin masks
+
+#include "legal_moves.h"
+
+#include <initializer_list>
+
+namespace ChessCore {
+
+namespace {
+
+Move* make_promotions(Move* moveList, Square from, Square to) {
+    *moveList++ = Move::make<PROMOTION>(from, to, QUEEN);
+    *moveList++ = Move::make<PROMOTION>(from, to, ROOK);
+    *moveList++ = Move::make<PROMOTION>(from, to, BISHOP);
+    *moveList++ = Move::make<PROMOTION>(from, to, KNIGHT);
+    return moveList;
+}
+
+Move* generate_pawn_moves(const Board& board, Move* moveList, Bitboard target, Bitboard pinned, Square ksq) {
+    Color us = board.side_to_move(), them = ~us;
+    Bitboard occupied = board.pieces();
+
+    for (Bitboard b = board.pieces(us, PAWN); b; ) {
+        Square from = pop_lsb(b);
+        Bitboard targets = 0;
+
+        Square one = Square(from + pawn_push(us));
+        if (board.empty(one)) {
+            targets |= square_bb(one);
+            Square two = Square(one + pawn_push(us));
+            if (relative_rank(us, rank_of(from)) == RANK_2 && board.empty(two))
+                targets |= square_bb(two);
+        }
+        targets |= pawn_attacks(us, from) & board.pieces(them);
+        targets &= target;
+
+        // A pinned pawn can only move along the line through its king
+        if (pinned & square_bb(from))
+            targets &= line_bb(ksq, from);
+
+        while (targets) {
+            Square to = pop_lsb(targets);
+            if (relative_rank(us, rank_of(to)) == RANK_8)
+                moveList = make_promotions(moveList, from, to);
+            else
+                *moveList++ = Move(from, to);
+        }
+
+        // En passant removes two pieces from the same rank, which can expose
+        // the king in ways the pin mask does not see. Test it directly on
+        // the resulting occupancy instead.
+        Square ep = board.ep_square();
+        if (ep != SQ_NONE && (pawn_attacks(us, from) & square_bb(ep))) {
+            Square capsq = Square(ep - pawn_push(us));
+            Bitboard occ = (occupied ^ square_bb(from) ^ square_bb(capsq)) | square_bb(ep);
+            if (!(board.attackers_to(ksq, occ) & board.pieces(them) & ~square_bb(capsq)))
+                *moveList++ = Move::make<EN_PASSANT>(from, ep);
+        }
+    }
+    return moveList;
+}
+
+Move* generate_piece_moves(const Board& board, Move* moveList, PieceType pt, Bitboard target, Bitboard pinned, Square ksq) {
+    Color us = board.side_to_move();
+    Bitboard occupied = board.pieces();
+
+    for (Bitboard b = board.pieces(us, pt); b; ) {
+        Square from = pop_lsb(b);
+        Bitboard targets = attacks_bb(pt, from, occupied) & target;
+        if (pinned & square_bb(from))
+            targets &= line_bb(ksq, from);
+        while (targets)
+            *moveList++ = Move(from, pop_lsb(targets));
+    }
+    return moveList;
+}
+
+Move* generate_king_moves(const Board& board, Move* moveList, Bitboard checkers, Square ksq) {
+    Color us = board.side_to_move(), them = ~us;
+    // The enemy attack map already looks through our king
+    Bitboard attacked = board.attacked(them);
+
+    for (Bitboard targets = Attacks::PseudoAttacks[KING][ksq] & ~board.pieces(us) & ~attacked; targets; )
+        *moveList++ = Move(ksq, pop_lsb(targets));
+
+    if (checkers || ksq != relative_square(us, SQ_E1))
+        return moveList;
+
+    // Castling: rook in place, path empty, and the king does not cross or
+    // land on an attacked square
+    Piece rook = make_piece(us, ROOK);
+    int rights = board.castling_rights();
+    Bitboard occupied = board.pieces();
+    const Bitboard kingPathOO = square_bb(relative_square(us, SQ_F1)) | square_bb(relative_square(us, SQ_G1));
+    const Bitboard kingPathOOO = square_bb(relative_square(us, SQ_D1)) | square_bb(relative_square(us, SQ_C1));
+
+    if ((rights & (us == WHITE ? WHITE_OO : BLACK_OO)) && board.piece_on(relative_square(us, SQ_H1)) == rook
+        && !(occupied & kingPathOO) && !(attacked & kingPathOO))
+        *moveList++ = Move::make<CASTLING>(ksq, relative_square(us, SQ_G1));
+
+    if ((rights & (us == WHITE ? WHITE_OOO : BLACK_OOO)) && board.piece_on(relative_square(us, SQ_A1)) == rook
+        && !(occupied & (kingPathOOO | square_bb(relative_square(us, SQ_B1)))) && !(attacked & kingPathOOO))
+        *moveList++ = Move::make<CASTLING>(ksq, relative_square(us, SQ_C1));
+
+    return moveList;
+}
+
+} // namespace
+
+Move* generate_legal(const Board& board, Move* moveList) {
+    Color us = board.side_to_move();
+    Square ksq = board.king_square(us);
+    Bitboard checkers = board.checkers();
+
+    // In double check only the king can move
+    if (!more_than_one(checkers)) {
+        // Non-king moves must capture the checker or block the check
+        Bitboard target = checkers ? between_bb(ksq, lsb(checkers)) | checkers : ~board.pieces(us);
+        target &= ~board.pieces(us);
+        Bitboard pinned = board.pinned(us);
+
+        moveList = generate_pawn_moves(board, moveList, target, pinned, ksq);
+        for (PieceType pt : { KNIGHT, BISHOP, ROOK, QUEEN })
+            moveList = generate_piece_moves(board, moveList, pt, target, pinned, ksq);
+    }
+
+    return generate_king_moves(board, moveList, checkers, ksq);
+}
+
+bool MoveList::contains(Move m) const {
+    for (const Move& move : *this)
+        if (move == m)
+            return true;
+    return false;
+}
+
+Bitboard MoveList::targets_from(Square from) const {
+    Bitboard targets = 0;
+    for (const Move& m : *this)
+        if (m.from_sq() == from)
+            targets |= square_bb(m.to_sq());
+    return targets;
+}
+
+Move MoveList::find(Square from, Square to, PieceType promotion) const {
+    for (const Move& m : *this)
+        if (m.from_sq() == from && m.to_sq() == to
+            && (m.type_of() != PROMOTION || m.promotion_type() == promotion))
+            return m;
+    return Move::none();
+}
+
+const MoveList& MoveListCache::get(const Board& board) {
+    Entry& e = table[board.key() & (SIZE - 1)];
+    if (!e.valid || e.key != board.key()) {
+        e.key = board.key();
+        e.valid = true;
+        e.moves = MoveList(board);
+    }
+    return e.moves;
+}
+
+void MoveListCache::clear() {
+    for (Entry& e : table)
+        e.valid = false;
+}
+
+} // namespace ChessCore
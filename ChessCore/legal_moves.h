@@ -0,0 +1,67 @@
+// legal_moves.h: legal move generation for the side to move.
+// Checkers and pinned pieces are computed once per call, so every move is
+// emitted already legal, without playing it on the board.
+
+#pragma once
+
+#include "board.h"
+#include "chess_types.h"
+
+namespace ChessCore {
+
+constexpr int MAX_MOVES = 256;
+
+// Writes all legal moves of the side to move to moveList and returns a
+// pointer past the last one. Promotions are emitted once per piece type.
+Move* generate_legal(const Board& board, Move* moveList);
+
+// Flat, fixed-capacity list of legal moves. It holds no pointers into
+// itself, so the GUI can keep a copy as its per-turn cache.
+class MoveList {
+public:
+    MoveList() : count(0) {}
+    explicit MoveList(const Board& board) { count = int(generate_legal(board, moveList) - moveList); }
+
+    const Move* begin() const { return moveList; }
+    const Move* end() const { return moveList + count; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    bool contains(Move m) const;
+
+    // Destination squares of the piece on 'from', for move highlighting
+    Bitboard targets_from(Square from) const;
+
+    // The move of the piece on 'from' to 'to', picking 'promotion' among
+    // promotion moves. Returns Move::none() if there is no such move.
+    Move find(Square from, Square to, PieceType promotion = QUEEN) const;
+
+private:
+    Move moveList[MAX_MOVES];
+    int count;
+};
+
+// Small direct-mapped cache of move lists indexed by Zobrist key. Positions
+// reached again by shuffling pieces back and forth are served from here
+// instead of being generated again.
+class MoveListCache {
+public:
+    static constexpr int SIZE = 64; // Must be a power of two
+
+    MoveListCache() { clear(); }
+
+    // The legal moves of the board's position, generated on a miss. The
+    // reference stays valid until the next call.
+    const MoveList& get(const Board& board);
+    void clear();
+
+private:
+    struct Entry {
+        Key key;
+        bool valid;
+        MoveList moves;
+    };
+    Entry table[SIZE];
+};
+
+} // namespace ChessCore
@@ -0,0 +1,340 @@
+// opening_tree.cpp: memory-mapped opening tree and its external-sort builder
+
+#include "opening_tree.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <thread>
+
+#include "board.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ChessCore {
+
+namespace {
+
+constexpr char Magic[8] = { 'C', 'C', 'O', 'P', 'T', 'R', 'E', 'E' };
+constexpr uint32_t Version = 1;
+
+} // namespace
+
+struct alignas(32) OpeningTree::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t entrySize;
+    uint64_t count;
+    uint64_t games;
+    Key keyCheck;
+};
+
+// -------------------- platform backends --------------------
+#ifdef _WIN32
+
+bool OpeningTree::open(const std::string& path) {
+    close();
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size{};
+    HANDLE m = GetFileSizeEx(f, &size) && size.QuadPart >= LONGLONG(sizeof(Header))
+             ? CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    void* v = m ? MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!v) {
+        if (m) CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+    file = f;
+    mapping = m;
+    view = v;
+    viewBytes = uint64_t(size.QuadPart);
+    return attach();
+}
+
+void OpeningTree::close() {
+    if (view)
+        UnmapViewOfFile(view);
+    if (mapping)
+        CloseHandle((HANDLE)mapping);
+    if (file)
+        CloseHandle((HANDLE)file);
+    file = mapping = nullptr;
+    view = nullptr;
+    entries = nullptr;
+    count = 0;
+    gameCount = 0;
+}
+
+#else
+
+bool OpeningTree::open(const std::string& path) {
+    close();
+    int f = ::open(path.c_str(), O_RDONLY);
+    if (f < 0)
+        return false;
+    struct stat st;
+    void* v = fstat(f, &st) == 0 && uint64_t(st.st_size) >= sizeof(Header)
+            ? mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, f, 0) : MAP_FAILED;
+    if (v == MAP_FAILED) {
+        ::close(f);
+        return false;
+    }
+    fd = f;
+    view = v;
+    viewBytes = uint64_t(st.st_size);
+    return attach();
+}
+
+void OpeningTree::close() {
+    if (view)
+        munmap(const_cast<void*>(view), size_t(viewBytes));
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    view = nullptr;
+    entries = nullptr;
+    count = 0;
+    gameCount = 0;
+}
+
+#endif
+
+// -------------------- tree --------------------
+
+// Checks the mapped header; closes the file if it is not a usable tree
+bool OpeningTree::attach() {
+    const Header* header = static_cast<const Header*>(view);
+    Board b;
+    b.set(StartFEN);
+    if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version
+        || header->entrySize != sizeof(Entry) || header->keyCheck != b.key()
+        || sizeof(Header) + header->count * sizeof(Entry) > viewBytes) {
+        close();
+        return false;
+    }
+    entries = reinterpret_cast<const Entry*>(header + 1);
+    count = size_t(header->count);
+    gameCount = header->games;
+    return true;
+}
+
+void OpeningTree::lookup(Key key, std::vector<Entry>& moves) const {
+    moves.clear();
+    const Entry* end = entries + count;
+    const Entry* it = std::lower_bound(entries, end, key, [](const Entry& e, Key k) { return e.key < k; });
+    for (; it != end && it->key == key; ++it)
+        moves.push_back(*it);
+    std::stable_sort(moves.begin(), moves.end(), [](const Entry& a, const Entry& b) { return a.games > b.games; });
+}
+
+// -------------------- builder --------------------
+
+namespace {
+
+template<typename NodeT>
+bool node_less(const NodeT& a, const NodeT& b) {
+    return a.key != b.key ? a.key < b.key : a.move < b.move;
+}
+
+template<typename NodeT>
+void accumulate(NodeT& into, const NodeT& n) {
+    into.evalSum += n.evalSum;
+    into.games += n.games;
+    into.whiteWins += n.whiteWins;
+    into.draws += n.draws;
+    into.blackWins += n.blackWins;
+    into.evalGames += n.evalGames;
+}
+
+} // namespace
+
+OpeningTreeBuilder::~OpeningTreeBuilder() {
+    wait_runs(0);
+    for (uint64_t n = 0; n < runsOnDisk; ++n)
+        std::remove(run_path(n).c_str());
+}
+
+void OpeningTreeBuilder::begin(const std::string& path, const Options& options) {
+    treePath = path;
+    counters = Stats();
+    runsOnDisk = 0;
+    runsOk = true;
+    maxInFlight = size_t(options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency()));
+    // One buffer filling and up to maxInFlight being sorted
+    runCapacity = std::max<size_t>(1024, options.memoryMB * 1024 * 1024 / sizeof(Node) / (maxInFlight + 1));
+    buffer.clear();
+    buffer.reserve(runCapacity);
+}
+
+void OpeningTreeBuilder::add(Key key, Move move, GameResult result, int16_t eval) {
+    Node n{};
+    n.key = key;
+    n.move = move.raw();
+    n.games = 1;
+    n.whiteWins = result == RESULT_WHITE_WINS;
+    n.draws = result == RESULT_DRAW;
+    n.blackWins = result == RESULT_BLACK_WINS;
+    if (eval != ArchivedGame::NO_EVAL) {
+        n.evalSum = eval;
+        n.evalGames = 1;
+    }
+    buffer.push_back(n);
+    ++counters.samples;
+    if (buffer.size() == runCapacity)
+        flush_run();
+}
+
+std::string OpeningTreeBuilder::run_path(uint64_t n) const {
+    return treePath + ".run" + std::to_string(n);
+}
+
+// Sorts a run, folds equal (key, move) samples together and writes it out
+bool OpeningTreeBuilder::write_run(std::vector<Node>& nodes, const std::string& path) {
+    std::sort(nodes.begin(), nodes.end(), node_less<Node>);
+    size_t out = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (out > 0 && nodes[out - 1].key == nodes[i].key && nodes[out - 1].move == nodes[i].move)
+            accumulate(nodes[out - 1], nodes[i]);
+        else
+            nodes[out++] = nodes[i];
+    }
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char*>(nodes.data()), std::streamsize(out * sizeof(Node)));
+    return bool(f);
+}
+
+void OpeningTreeBuilder::flush_run() {
+    if (buffer.empty())
+        return;
+    wait_runs(maxInFlight - 1);
+    std::string path = run_path(runsOnDisk++);
+    ++counters.runs;
+    pending.push_back(std::async(std::launch::async, [nodes = std::move(buffer), path]() mutable {
+        return write_run(nodes, path);
+    }));
+    buffer = std::vector<Node>();
+    buffer.reserve(runCapacity);
+}
+
+// Waits until at most 'keep' runs are still being written
+void OpeningTreeBuilder::wait_runs(size_t keep) {
+    while (pending.size() > keep) {
+        runsOk &= pending.front().get();
+        pending.erase(pending.begin());
+    }
+}
+
+bool OpeningTreeBuilder::finish(Key keyCheck) {
+    flush_run();
+    wait_runs(0);
+    buffer = std::vector<Node>();
+    if (!runsOk)
+        return false;
+
+    // k-way merge: each run is read through a small buffer, the heap holds
+    // the smallest unread node of every run
+    struct RunReader {
+        std::ifstream in;
+        std::vector<Node> nodes;
+        size_t pos = 0;
+        bool next(size_t chunk) {
+            if (++pos < nodes.size())
+                return true;
+            nodes.resize(chunk);
+            in.read(reinterpret_cast<char*>(nodes.data()), std::streamsize(chunk * sizeof(Node)));
+            nodes.resize(size_t(in.gcount()) / sizeof(Node));
+            pos = 0;
+            return !nodes.empty();
+        }
+        const Node& top() const { return nodes[pos]; }
+    };
+
+    size_t runs = size_t(runsOnDisk);
+    size_t chunk = std::clamp<size_t>(runCapacity * (maxInFlight + 1) / std::max<size_t>(runs, 1), 64, 1 << 16);
+    std::vector<RunReader> readers(runs);
+    auto greater = [&](size_t a, size_t b) { return node_less(readers[b].top(), readers[a].top()); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+    for (size_t i = 0; i < runs; ++i) {
+        readers[i].in.open(run_path(i), std::ios::binary);
+        readers[i].pos = 0;
+        if (readers[i].next(chunk))
+            heap.push(i);
+    }
+
+    std::ofstream out(treePath, std::ios::binary | std::ios::trunc);
+    OpeningTree::Header header{};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<OpeningTree::Entry> batch;
+    batch.reserve(4096);
+    auto emit = [&](const Node& n) {
+        OpeningTree::Entry e;
+        e.key = n.key;
+        e.move = n.move;
+        e.avgEval = n.evalGames ? int16_t(n.evalSum / int64_t(n.evalGames)) : ArchivedGame::NO_EVAL;
+        e.games = n.games;
+        e.whiteWins = n.whiteWins;
+        e.draws = n.draws;
+        e.blackWins = n.blackWins;
+        e.evalGames = n.evalGames;
+        batch.push_back(e);
+        if (batch.size() == batch.capacity()) {
+            out.write(reinterpret_cast<const char*>(batch.data()), std::streamsize(batch.size() * sizeof(e)));
+            batch.clear();
+        }
+        ++counters.entries;
+    };
+
+    bool haveCurrent = false;
+    Node current{};
+    while (!heap.empty()) {
+        size_t i = heap.top();
+        heap.pop();
+        const Node& n = readers[i].top();
+        if (haveCurrent && current.key == n.key && current.move == n.move)
+            accumulate(current, n);
+        else {
+            if (haveCurrent)
+                emit(current);
+            current = n;
+            haveCurrent = true;
+        }
+        if (readers[i].next(chunk))
+            heap.push(i);
+    }
+    if (haveCurrent)
+        emit(current);
+    out.write(reinterpret_cast<const char*>(batch.data()), std::streamsize(batch.size() * sizeof(OpeningTree::Entry)));
+
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.entrySize = sizeof(OpeningTree::Entry);
+    header.count = counters.entries;
+    header.games = counters.games;
+    header.keyCheck = keyCheck;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+
+    readers.clear();
+    for (size_t i = 0; i < runs; ++i)
+        std::remove(run_path(i).c_str());
+    runsOnDisk = 0;
+    return bool(out);
+}
+
+} // namespace ChessCore
@@ -0,0 +1,142 @@
+// opening_tree.h: position -> move statistics over archived games.
+// The tree file is one array of fixed-size entries sorted by (key, move),
+// memory-mapped read-only, so the moves played from a position are found
+// with one binary search (O(log n)) and no loading time however many games
+// went into it. Keys are the raw Zobrist keys of ChessCore's Board, which
+// uses Stockfish's generator and seed; Stockfish's Position::key() also
+// mixes in the 50-move counter, so its StateInfo::key is what matches. The
+// header records the start position's key and a tree built with other keys
+// is refused.
+//
+// OpeningTreeBuilder writes the file from a stream of (key, move, result,
+// eval) samples with bounded memory: samples fill a run buffer, full runs
+// are sorted and aggregated on worker threads and written to temporary run
+// files, and finish() merges the runs into the tree.
+
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "chess_types.h"
+#include "game_archive.h"
+
+namespace ChessCore {
+
+class OpeningTree {
+public:
+    // One move from one position, over all games that played it there
+    struct Entry {
+        uint64_t key;
+        uint16_t move;      // Move::raw()
+        int16_t avgEval;    // Mean eval after the move, White's side; ArchivedGame::NO_EVAL if none
+        uint32_t games;
+        uint32_t whiteWins;
+        uint32_t draws;
+        uint32_t blackWins; // Unfinished games count in 'games' only
+        uint32_t evalGames; // Games with an eval for this move
+    };
+    static_assert(sizeof(Entry) == 32, "tree entry layout");
+
+    OpeningTree() = default;
+    ~OpeningTree() { close(); }
+    OpeningTree(const OpeningTree&) = delete;
+    OpeningTree& operator=(const OpeningTree&) = delete;
+
+    // Maps a tree written by OpeningTreeBuilder. Needs init() to have run.
+    // Returns false if the file is missing, damaged or built with other keys.
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return entries != nullptr; }
+
+    size_t size() const { return count; }
+    uint64_t games() const { return gameCount; }
+
+    // The moves played from the position with this key, most played first
+    void lookup(Key key, std::vector<Entry>& moves) const;
+
+private:
+    friend class OpeningTreeBuilder;
+    struct Header;
+
+    bool attach();
+
+    const Entry* entries = nullptr;
+    size_t count = 0;
+    uint64_t gameCount = 0;
+
+#ifdef _WIN32
+    void* file = nullptr;    // HANDLE
+    void* mapping = nullptr; // HANDLE
+#else
+    int fd = -1;
+#endif
+    const void* view = nullptr;
+    uint64_t viewBytes = 0;
+};
+
+class OpeningTreeBuilder {
+public:
+    struct Options {
+        size_t memoryMB = 256; // For all run buffers together
+        int threads = 0;       // Run sorts in flight; 0: hardware threads
+    };
+
+    struct Stats {
+        uint64_t games = 0;
+        uint64_t samples = 0;
+        uint64_t runs = 0;
+        uint64_t entries = 0;  // In the finished tree
+    };
+
+    OpeningTreeBuilder() = default;
+    ~OpeningTreeBuilder();
+    OpeningTreeBuilder(const OpeningTreeBuilder&) = delete;
+    OpeningTreeBuilder& operator=(const OpeningTreeBuilder&) = delete;
+
+    // Starts a tree at 'path'; run files go next to it as "<path>.run<N>"
+    void begin(const std::string& path, const Options& options);
+
+    void add_game() { ++counters.games; }
+    // 'move' was played from the position with 'key' in a game that ended
+    // with 'result'; eval is the archived eval after it
+    void add(Key key, Move move, GameResult result, int16_t eval);
+
+    // Merges the runs into the tree file and removes them. 'keyCheck' is
+    // the start position's key under the keys used for add().
+    bool finish(Key keyCheck);
+
+    const Stats& stats() const { return counters; }
+
+private:
+    // A sample or, once aggregated, the totals of one (key, move)
+    struct Node {
+        uint64_t key;
+        int64_t evalSum;
+        uint16_t move;
+        uint16_t reserved;
+        uint32_t games;
+        uint32_t whiteWins;
+        uint32_t draws;
+        uint32_t blackWins;
+        uint32_t evalGames;
+    };
+
+    void flush_run();
+    void wait_runs(size_t keep);
+    std::string run_path(uint64_t n) const;
+    static bool write_run(std::vector<Node>& nodes, const std::string& path);
+
+    std::string treePath;
+    size_t runCapacity = 0;
+    size_t maxInFlight = 1;
+    uint64_t runsOnDisk = 0; // Run files written and not yet merged
+    std::vector<Node> buffer;
+    std::vector<std::future<bool>> pending; // Runs being sorted and written
+    bool runsOk = true;
+    Stats counters;
+};
+
+} // namespace ChessCore
@@ -0,0 +1,111 @@
+// piece_sprites.cpp: piece image atlas for the OpenCV renderers
+
+#include "piece_sprites.h"
+
+#include <algorithm>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "sprite_composite.h"
+
+namespace ChessCore {
+
+const char* PieceSprites::file_name(Piece pc) {
+    static const char* Names[PIECE_NB] = {
+        "", "Pawn_white.png", "Knight_white.png", "Bishop_white.png", "Rook_white.png", "Queen_white.png", "King_white.png", "",
+        "", "Pawn_black.png", "Knight_black.png", "Bishop_black.png", "Rook_black.png", "Queen_black.png", "King_black.png", ""
+    };
+    return Names[pc];
+}
+
+bool PieceSprites::load(const std::string& dir, int size) {
+    bool all = true;
+    for (Piece pc : { W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
+                      B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING }) {
+        cv::Mat& image = decoded[slot(pc)];
+        image = cv::imread(dir + file_name(pc), cv::IMREAD_UNCHANGED);
+        loaded[slot(pc)] = !image.empty();
+        if (image.empty()) {
+            all = false;
+            continue;
+        }
+        // Everything becomes BGRA; images without alpha are opaque
+        if (image.channels() == 1)
+            cv::cvtColor(image, image, cv::COLOR_GRAY2BGRA);
+        else if (image.channels() == 3)
+            cv::cvtColor(image, image, cv::COLOR_BGR2BGRA);
+        // Premultiplied before scaling, so transparent pixels' colour does
+        // not bleed into the edges
+        for (int y = 0; y < image.rows; ++y) {
+            uchar* p = image.ptr<uchar>(y);
+            for (int x = 0; x < image.cols; ++x, p += 4) {
+                p[0] = uchar(div255(p[0] * p[3]));
+                p[1] = uchar(div255(p[1] * p[3]));
+                p[2] = uchar(div255(p[2] * p[3]));
+            }
+        }
+    }
+    spriteSize = 0;
+    set_size(size);
+    return all;
+}
+
+void PieceSprites::set_size(int size) {
+    if (size == spriteSize && !atlas.empty())
+        return;
+    spriteSize = size;
+    atlas.create(SPRITE_NB * size, size, CV_8UC4);
+    atlas.setTo(cv::Scalar::all(0));
+
+    for (int i = 0; i < SPRITE_NB; ++i) {
+        if (!loaded[i])
+            continue;
+        cv::Mat out = atlas.rowRange(i * size, (i + 1) * size);
+        // Area averaging when shrinking (no ringing), cubic when enlarging
+        int interpolation = decoded[i].cols > size ? cv::INTER_AREA : cv::INTER_CUBIC;
+        cv::resize(decoded[i], out, out.size(), 0, 0, interpolation);
+        // Cubic overshoot could leave colour above alpha, which would
+        // overflow when composited
+        for (int y = 0; y < size; ++y) {
+            uchar* p = out.ptr<uchar>(y);
+            for (int x = 0; x < size; ++x, p += 4)
+                for (int c = 0; c < 3; ++c)
+                    p[c] = std::min(p[c], p[3]);
+        }
+    }
+}
+
+PieceSprites PieceSprites::resized(int size) const {
+    PieceSprites copy;
+    for (int i = 0; i < SPRITE_NB; ++i) {
+        copy.decoded[i] = decoded[i];
+        copy.loaded[i] = loaded[i];
+    }
+    copy.set_size(size);
+    return copy;
+}
+
+cv::Mat PieceSprites::sprite(Piece pc) const {
+    return has(pc) ? atlas.rowRange(slot(pc) * spriteSize, (slot(pc) + 1) * spriteSize) : cv::Mat();
+}
+
+bool PieceSprites::draw(cv::Mat& board, Piece pc, const cv::Rect& square) const {
+    if (!has(pc))
+        return false;
+
+    cv::Mat roi = board(square);
+    cv::Mat src = sprite(pc);
+    if (square.width != spriteSize || square.height != spriteSize) {
+        // Squares of another size than the atlas: scale on the fly.
+        // Premultiplied pixels interpolate correctly as they are.
+        cv::Mat scaled;
+        cv::resize(src, scaled, square.size(), 0, 0, cv::INTER_LINEAR);
+        src = scaled;
+    }
+    for (int y = 0; y < roi.rows; ++y)
+        composite_row(roi.ptr<uchar>(y), src.ptr<uchar>(y), roi.cols);
+    return true;
+}
+
+} // namespace ChessCore
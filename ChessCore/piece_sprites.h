@@ -0,0 +1,56 @@
+// piece_sprites.h: decoded piece images for the OpenCV board renderers.
+// The twelve PNGs are decoded once; the sprites for the current square size
+// are scaled from those decoded images once per size (at startup, or when
+// the board is resized) into one atlas: a single contiguous BGRA image with
+// the sprites stacked top to bottom and the colour premultiplied by alpha.
+// Drawing a piece is then one pass over its pixels, dst = src + dst * (1 -
+// alpha), with partial alpha kept so the edges stay antialiased (the SIMD
+// kernel in sprite_composite.h). Nothing here touches Win32, so a launcher
+// can load the sprites on a worker thread while it waits for the user.
+
+#pragma once
+
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "chess_types.h"
+
+namespace ChessCore {
+
+class PieceSprites {
+public:
+    static constexpr int SPRITE_NB = 12;
+
+    // Image file of each piece, e.g. "Pawn_white.png"; "" for NO_PIECE
+    static const char* file_name(Piece pc);
+
+    // Decodes the images in 'dir' (empty or ending in a separator) and
+    // builds the atlas for size x size squares. Returns false if any image
+    // is missing; the missing pieces stay empty.
+    bool load(const std::string& dir, int size);
+    // Rebuilds the atlas for another square size from the decoded images
+    void set_size(int size);
+    // A copy with its own atlas for 'size'; shares the decoded images, so
+    // it can be built on another thread while this one is drawn from
+    PieceSprites resized(int size) const;
+
+    bool has(Piece pc) const { return type_of(pc) != NO_PIECE_TYPE && loaded[slot(pc)]; }
+    int size() const { return spriteSize; }
+    // The premultiplied BGRA sprite of pc, a view into the atlas
+    cv::Mat sprite(Piece pc) const;
+
+    // Draws pc into 'square' of a BGR board image, blending by the sprite's
+    // alpha. Returns false if there is no sprite for pc.
+    bool draw(cv::Mat& board, Piece pc, const cv::Rect& square) const;
+
+private:
+    static int slot(Piece pc) { return color_of(pc) * 6 + type_of(pc) - 1; }
+
+    cv::Mat decoded[SPRITE_NB]; // Premultiplied BGRA at the file's resolution
+    bool loaded[SPRITE_NB] = {};
+    cv::Mat atlas;              // CV_8UC4, SPRITE_NB * size rows, premultiplied
+    int spriteSize = 0;
+};
+
+} // namespace ChessCore
@@ -0,0 +1,227 @@
+// result_cache.cpp: memory-mapped engine result cache
+
+#include "result_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "board.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ChessCore {
+
+namespace {
+
+constexpr char Magic[8] = { 'C', 'C', 'R', 'E', 'S', 'U', 'L', 'T' };
+constexpr uint32_t Version = 1;
+
+// Changes whenever the Zobrist keys do, so stale files are recognised
+Key key_check() {
+    Board b;
+    b.set(StartFEN);
+    return b.key();
+}
+
+} // namespace
+
+struct alignas(64) ResultCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t entrySize;
+    uint64_t clusterCount;
+    Key keyCheck;
+};
+
+// -------------------- platform backends --------------------
+#ifdef _WIN32
+
+bool ResultCache::map_file(const std::string& path, uint64_t bytes) {
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE)
+        return false;
+
+    // A file of another size belongs to another cache size: cut or grow it
+    LARGE_INTEGER size{};
+    LARGE_INTEGER wanted{};
+    wanted.QuadPart = LONGLONG(bytes);
+    if (!GetFileSizeEx(f, &size)
+        || (size.QuadPart != wanted.QuadPart
+            && (!SetFilePointerEx(f, wanted, NULL, FILE_BEGIN) || !SetEndOfFile(f)))) {
+        CloseHandle(f);
+        return false;
+    }
+
+    HANDLE m = CreateFileMappingA(f, NULL, PAGE_READWRITE, DWORD(bytes >> 32), DWORD(bytes), NULL);
+    void* v = m ? MapViewOfFile(m, FILE_MAP_ALL_ACCESS, 0, 0, SIZE_T(bytes)) : nullptr;
+    if (!v) {
+        if (m) CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+    file = f;
+    mapping = m;
+    view = v;
+    viewBytes = bytes;
+    return true;
+}
+
+void ResultCache::close() {
+    if (view)
+        UnmapViewOfFile(view);
+    if (mapping)
+        CloseHandle((HANDLE)mapping);
+    if (file)
+        CloseHandle((HANDLE)file);
+    file = mapping = view = nullptr;
+    header = nullptr;
+    clusters = nullptr;
+    clusterCount = 0;
+}
+
+#else
+
+bool ResultCache::map_file(const std::string& path, uint64_t bytes) {
+    int f = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (f < 0)
+        return false;
+
+    // A file of another size belongs to another cache size: cut or grow it
+    struct stat st;
+    if (fstat(f, &st) != 0 || (uint64_t(st.st_size) != bytes && ftruncate(f, off_t(bytes)) != 0)) {
+        ::close(f);
+        return false;
+    }
+
+    void* v = mmap(nullptr, size_t(bytes), PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+    if (v == MAP_FAILED) {
+        ::close(f);
+        return false;
+    }
+    fd = f;
+    view = v;
+    viewBytes = bytes;
+    return true;
+}
+
+void ResultCache::close() {
+    if (view)
+        munmap(view, size_t(viewBytes));
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    view = nullptr;
+    header = nullptr;
+    clusters = nullptr;
+    clusterCount = 0;
+}
+
+#endif
+
+// -------------------- table --------------------
+
+bool ResultCache::open(const std::string& path, size_t sizeMB) {
+    close();
+    counters = Stats();
+
+    // Largest power of two that fits, so the index is a mask of the key
+    size_t count = 1;
+    while (count * 2 * sizeof(Cluster) <= sizeMB * 1024 * 1024)
+        count *= 2;
+
+    uint64_t bytes = sizeof(Header) + uint64_t(count) * sizeof(Cluster);
+    if (!map_file(path, bytes))
+        return false;
+
+    header = static_cast<Header*>(view);
+    clusters = reinterpret_cast<Cluster*>(header + 1);
+    clusterCount = count;
+
+    Key check = key_check();
+    if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version
+        || header->entrySize != sizeof(Entry) || header->clusterCount != count || header->keyCheck != check) {
+        std::memset(view, 0, size_t(bytes));
+        std::memcpy(header->magic, Magic, sizeof(Magic));
+        header->version = Version;
+        header->entrySize = sizeof(Entry);
+        header->clusterCount = count;
+        header->keyCheck = check;
+    }
+    return true;
+}
+
+bool ResultCache::probe(Key key, int minDepth, Result& out) {
+    if (!clusters || !key)
+        return false;
+    ++counters.probes;
+
+    for (const Entry& e : clusters[key & (clusterCount - 1)].entry) {
+        if (e.key != key)
+            continue;
+        if (e.depth < minDepth) {
+            ++counters.shallow;
+            return false;
+        }
+        out.best = Move(e.best);
+        out.ponder = Move(e.ponder);
+        out.score = e.score;
+        out.isMate = e.flags & 1;
+        out.bound = ScoreBound((e.flags >> 1) & 3);
+        out.depth = e.depth;
+        ++counters.hits;
+        return true;
+    }
+    return false;
+}
+
+void ResultCache::store(Key key, const Result& r) {
+    if (!clusters || !key || !r.best)
+        return;
+
+    // Same position: keep the deeper result. Otherwise take an empty entry
+    // or the shallowest one.
+    Cluster& c = clusters[key & (clusterCount - 1)];
+    Entry* slot = &c.entry[0];
+    for (Entry& e : c.entry) {
+        if (e.key == key) {
+            if (e.depth > r.depth)
+                return;
+            slot = &e;
+            break;
+        }
+        if (e.depth < slot->depth || (!e.key && slot->key))
+            slot = &e;
+    }
+
+    slot->key = key;
+    slot->best = r.best.raw();
+    slot->ponder = r.ponder.raw();
+    slot->score = int16_t(std::clamp(r.score, -32000, 32000));
+    slot->depth = uint8_t(std::clamp(r.depth, 0, 255));
+    slot->flags = uint8_t((r.isMate ? 1 : 0) | (r.bound << 1));
+    ++counters.stores;
+}
+
+int ResultCache::fill_permille() const {
+    if (!clusters)
+        return 0;
+    size_t sample = std::min<size_t>(clusterCount, 1000);
+    size_t used = 0;
+    for (size_t i = 0; i < sample; ++i)
+        for (const Entry& e : clusters[i].entry)
+            used += e.key != 0;
+    return int(used * 1000 / (sample * CLUSTER_SIZE));
+}
+
+} // namespace ChessCore
@@ -0,0 +1,97 @@
+// result_cache.h: persistent cache of finished engine searches.
+// Best move, ponder move, score and depth are kept per position in a file
+// that is memory-mapped for the whole session, so a position seen in an
+// earlier game (the opening of every game, a position reached again after a
+// takeback) is answered from the file instead of searched again. The table
+// works like an engine transposition table: fixed-size clusters of four
+// 16-byte entries, one cache line each, indexed by the position's Zobrist
+// key and replaced by depth. Zobrist keys come from a fixed seed, so they
+// stay valid across sessions; the file header records a check key and a
+// file written with other keys is cleared on open.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "chess_types.h"
+#include "search_info.h"
+
+namespace ChessCore {
+
+class ResultCache {
+public:
+    struct Result {
+        Move best = Move::none();
+        Move ponder = Move::none();
+        int score = 0;     // From the side to move: centipawns or moves to mate
+        bool isMate = false;
+        ScoreBound bound = BOUND_EXACT;
+        int depth = 0;
+    };
+
+    // Counters since open(), for sizing the file
+    struct Stats {
+        uint64_t probes = 0;
+        uint64_t hits = 0;    // Found with enough depth
+        uint64_t shallow = 0; // Found, but searched less deeply than asked for
+        uint64_t stores = 0;
+    };
+
+    ResultCache() = default;
+    ~ResultCache() { close(); }
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Maps 'path', creating or resizing it to about sizeMB megabytes.
+    // Existing entries are kept if the file has the same size and keys.
+    // Needs init() to have run. Returns false if the file cannot be mapped.
+    bool open(const std::string& path, size_t sizeMB);
+    void close();
+    bool is_open() const { return clusters != nullptr; }
+
+    // Looks up key; true if a result of at least minDepth was found. The
+    // moves are only as trustworthy as the key, so check them against the
+    // legal moves before playing them.
+    bool probe(Key key, int minDepth, Result& out);
+    void store(Key key, const Result& r);
+
+    const Stats& stats() const { return counters; }
+    size_t capacity() const { return clusterCount * CLUSTER_SIZE; }
+    // Used entries per mille, sampled from the first clusters like UCI hashfull
+    int fill_permille() const;
+
+private:
+    static constexpr int CLUSTER_SIZE = 4;
+
+    struct Entry {
+        uint64_t key;      // 0: empty
+        uint16_t best;
+        uint16_t ponder;
+        int16_t score;
+        uint8_t depth;
+        uint8_t flags;     // Bit 0: mate score, bits 1-2: ScoreBound
+    };
+    struct alignas(64) Cluster {
+        Entry entry[CLUSTER_SIZE];
+    };
+    struct Header;
+
+    bool map_file(const std::string& path, uint64_t bytes);
+
+    Header* header = nullptr;
+    Cluster* clusters = nullptr;
+    size_t clusterCount = 0;
+    Stats counters;
+
+#ifdef _WIN32
+    void* file = nullptr;    // HANDLE
+    void* mapping = nullptr; // HANDLE
+#else
+    int fd = -1;
+#endif
+    void* view = nullptr;
+    uint64_t viewBytes = 0;
+};
+
+} // namespace ChessCore
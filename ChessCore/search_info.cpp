@@ -0,0 +1,103 @@
+// search_info.cpp: UCI info line parser and search report records
+
+#include "search_info.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace ChessCore {
+
+namespace {
+
+// Splits off the next space-separated token of 'rest'
+std::string_view next_token(std::string_view& rest) {
+    size_t begin = rest.find_first_not_of(' ');
+    if (begin == std::string_view::npos) {
+        rest = std::string_view();
+        return rest;
+    }
+    size_t end = rest.find(' ', begin);
+    std::string_view token = rest.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+    rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+    return token;
+}
+
+template<typename T>
+bool next_number(std::string_view& rest, T& value) {
+    std::string_view token = next_token(rest);
+    return std::from_chars(token.data(), token.data() + token.size(), value).ec == std::errc();
+}
+
+} // namespace
+
+bool parse_info(std::string_view line, SearchInfo& info) {
+    std::string_view rest = line;
+    if (next_token(rest) != "info")
+        return false;
+
+    info = SearchInfo();
+    bool hasScore = false;
+
+    for (std::string_view token; !(token = next_token(rest)).empty(); ) {
+        if (token == "depth")
+            next_number(rest, info.depth);
+        else if (token == "seldepth")
+            next_number(rest, info.selDepth);
+        else if (token == "multipv")
+            next_number(rest, info.multiPV);
+        else if (token == "score") {
+            std::string_view kind = next_token(rest);
+            info.isMate = kind == "mate";
+            hasScore = next_number(rest, info.score) && (info.isMate || kind == "cp");
+        }
+        else if (token == "lowerbound")
+            info.bound = BOUND_LOWER;
+        else if (token == "upperbound")
+            info.bound = BOUND_UPPER;
+        else if (token == "wdl")
+            info.hasWdl = next_number(rest, info.wdl[0]) && next_number(rest, info.wdl[1]) && next_number(rest, info.wdl[2]);
+        else if (token == "nodes")
+            next_number(rest, info.nodes);
+        else if (token == "nps")
+            next_number(rest, info.nps);
+        else if (token == "tbhits")
+            next_number(rest, info.tbHits);
+        else if (token == "hashfull")
+            next_number(rest, info.hashfull);
+        else if (token == "time")
+            next_number(rest, info.timeMs);
+        else if (token == "pv") {
+            // The PV runs to the end of the line
+            size_t begin = rest.find_first_not_of(' ');
+            info.pv = begin == std::string_view::npos ? std::string_view() : rest.substr(begin);
+            break;
+        }
+        else if (token == "string" || token == "currmove")
+            return false;
+    }
+    return hasScore;
+}
+
+void SearchInfoRecord::assign(const SearchInfo& i) {
+    size_t len = std::min(i.pv.size(), MAX_PV_CHARS);
+    if (len < i.pv.size()) {
+        size_t space = i.pv.substr(0, len).rfind(' ');
+        len = space == std::string_view::npos ? 0 : space;
+    }
+    info = i;
+    info.pv = std::string_view();
+    std::memcpy(pvText, i.pv.data(), len);
+    pvLen = len;
+}
+
+void SearchInfoLines::update(const SearchInfoRecord& record) {
+    int idx = std::clamp(record.info.multiPV, 1, MAX_LINES) - 1;
+    lines[idx].info = record.info;
+    std::memcpy(lines[idx].pvText, record.pvText, record.pvLen);
+    lines[idx].pvLen = record.pvLen;
+    // A new iteration of line 1 starts a new set of lines
+    count = idx == 0 ? 1 : std::max(count, idx + 1);
+}
+
+} // namespace ChessCore
@@ -0,0 +1,94 @@
+// search_info.h: engine-neutral search limits and progress reports.
+// Both the child-process client and the in-process Stockfish adapter speak
+// in these types, so the GUI does not care which one is running.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "chess_types.h"
+
+namespace ChessCore {
+
+// Subset of the UCI "go" parameters the GUIs use. Zero means unset.
+struct SearchLimits {
+    int depth = 0;
+    int movetimeMs = 0;
+    uint64_t nodes = 0;
+    int timeMs[COLOR_NB] = { 0, 0 };
+    int incMs[COLOR_NB] = { 0, 0 };
+    int movestogo = 0;
+    bool infinite = false;
+    bool ponder = false;
+
+    // The equivalent UCI command, e.g. "go wtime 60000 btime 60000"
+    std::string go_command() const {
+        std::string s = "go";
+        if (ponder) s += " ponder";
+        if (timeMs[WHITE]) s += " wtime " + std::to_string(timeMs[WHITE]);
+        if (timeMs[BLACK]) s += " btime " + std::to_string(timeMs[BLACK]);
+        if (incMs[WHITE]) s += " winc " + std::to_string(incMs[WHITE]);
+        if (incMs[BLACK]) s += " binc " + std::to_string(incMs[BLACK]);
+        if (movestogo) s += " movestogo " + std::to_string(movestogo);
+        if (depth) s += " depth " + std::to_string(depth);
+        if (nodes) s += " nodes " + std::to_string(nodes);
+        if (movetimeMs) s += " movetime " + std::to_string(movetimeMs);
+        if (infinite) s += " infinite";
+        return s;
+    }
+};
+
+enum ScoreBound : uint8_t { BOUND_EXACT, BOUND_LOWER, BOUND_UPPER };
+
+// One completed search iteration, mirroring Stockfish's Search::InfoFull.
+// Scores are from the side to move.
+struct SearchInfo {
+    int depth = 0;
+    int selDepth = 0;
+    int multiPV = 1;
+    bool isMate = false;
+    int score = 0;       // Centipawns, or moves to mate (negative if being mated)
+    ScoreBound bound = BOUND_EXACT;
+    bool hasWdl = false;
+    int wdl[3] = { 0, 0, 0 }; // Win/draw/loss per mille
+    uint64_t nodes = 0;
+    uint64_t nps = 0;
+    uint64_t tbHits = 0;
+    int hashfull = 0;    // Per mille
+    int timeMs = 0;
+    std::string_view pv; // UCI moves separated by spaces; valid during the callback only
+};
+
+// Parses a UCI "info" line in place, without allocating. pv points into
+// 'line'. Returns false for lines that carry no score, such as currmove
+// updates and "info string".
+bool parse_info(std::string_view line, SearchInfo& info);
+
+// A SearchInfo holding its own copy of the PV, so it can be stored or
+// passed between threads by value. Fixed size: no allocation per report.
+struct SearchInfoRecord {
+    static constexpr size_t MAX_PV_CHARS = 512;
+
+    SearchInfo info; // info.pv is left empty; use pv()
+    char pvText[MAX_PV_CHARS];
+    size_t pvLen = 0;
+
+    // Copies info, cutting a PV that does not fit back to its last whole move
+    void assign(const SearchInfo& info);
+    std::string_view pv() const { return std::string_view(pvText, pvLen); }
+};
+
+// The latest report of each MultiPV line of a search
+struct SearchInfoLines {
+    static constexpr int MAX_LINES = 8;
+
+    int count = 0; // Lines in MultiPV order
+    SearchInfoRecord lines[MAX_LINES];
+
+    void update(const SearchInfoRecord& record);
+    void clear() { count = 0; }
+};
+
+} // namespace ChessCore
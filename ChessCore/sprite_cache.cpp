@@ -0,0 +1,101 @@
+// sprite_cache.cpp: sprite sizes built on a worker thread
+
+#include "sprite_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace ChessCore {
+
+void SpriteCache::reset(const PieceSprites* baseSprites, std::function<void()> readyHandler) {
+    stop();
+    base = baseSprites;
+    onReady = std::move(readyHandler);
+}
+
+void SpriteCache::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        wanted = 0;
+    }
+    if (worker.joinable())
+        worker.join();
+    std::lock_guard<std::mutex> lock(mutex);
+    built.clear();
+    cached.clear();
+    stopping = false;
+}
+
+void SpriteCache::build_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (wanted && !stopping) {
+        int size = building = wanted;
+        wanted = 0;
+        lock.unlock();
+        // Scaled from the full-resolution images: area averaging when
+        // shrinking, cubic when enlarging (PieceSprites::set_size)
+        auto sprites = std::make_shared<const PieceSprites>(base->resized(size));
+        lock.lock();
+        built.push_back(std::move(sprites));
+        building = 0;
+        if (onReady && !stopping) {
+            lock.unlock();
+            onReady();
+            lock.lock();
+        }
+    }
+    running = false;
+}
+
+const PieceSprites* SpriteCache::nearest(int size) const {
+    const PieceSprites* best = base;
+    for (const auto& sprites : cached) {
+        int d = std::abs(sprites->size() - size), bestD = std::abs(best->size() - size);
+        // On a tie the larger one, shrinking looks better than enlarging
+        if (d < bestD || (d == bestD && sprites->size() > best->size()))
+            best = sprites.get();
+    }
+    return best;
+}
+
+const PieceSprites* SpriteCache::get(int size) {
+    if (!base)
+        return nullptr;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& sprites : built)
+        if (!has(sprites->size()))
+            cached.push_back(std::move(sprites));
+    built.clear();
+
+    if (!has(size) && size != building && size > 0) {
+        wanted = size;
+        if (!running) {
+            // The previous worker has left its loop and only has to return
+            if (worker.joinable())
+                worker.join();
+            running = true;
+            worker = std::thread(&SpriteCache::build_loop, this);
+        }
+    }
+
+    // Keeps the sizes nearest to the current one
+    while ((int)cached.size() > MAX_SIZES) {
+        auto farthest = std::max_element(cached.begin(), cached.end(), [size](const auto& a, const auto& b) {
+            return std::abs(a->size() - size) < std::abs(b->size() - size);
+        });
+        cached.erase(farthest);
+    }
+    return nearest(size);
+}
+
+bool SpriteCache::has(int size) const {
+    if (base->size() == size)
+        return true;
+    for (const auto& sprites : cached)
+        if (sprites->size() == size)
+            return true;
+    return false;
+}
+
+} // namespace ChessCore
@@ -0,0 +1,62 @@
+// sprite_cache.h: piece sprites for whatever square size the window needs.
+// The GUIs scale the board to their window, so the square size changes
+// while the user drags a border or moves the window to a display with
+// another DPI. Scaling the twelve full-resolution PNGs for a new size takes
+// tens of milliseconds, so it never happens on the UI thread: get() returns
+// the cached size nearest to the one asked for at once (PieceSprites::draw
+// scales it to the square on the fly), and one worker thread builds the
+// exact size. When it is done the onReady callback runs on the worker
+// thread; the GUI posts itself a message and calls get() again. While a
+// drag keeps asking for new sizes only the latest is built next, and a few
+// recent sizes stay cached so dragging back is instant.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "piece_sprites.h"
+
+namespace ChessCore {
+
+class SpriteCache {
+public:
+    static constexpr int MAX_SIZES = 6; // Cached sizes besides the base
+
+    SpriteCache() = default;
+    ~SpriteCache() { stop(); }
+    SpriteCache(const SpriteCache&) = delete;
+    SpriteCache& operator=(const SpriteCache&) = delete;
+
+    // 'base' holds the decoded images and the first size; it must outlive
+    // the cache. onReady is called on the worker thread after each build.
+    void reset(const PieceSprites* base, std::function<void()> onReady);
+    // Waits for a build in progress and drops every size but the base
+    void stop();
+
+    // The sprites to draw size x size squares with now: that size if it is
+    // cached, the nearest one otherwise (and the exact one is queued). The
+    // pointer stays valid until the next call to get() or reset().
+    const PieceSprites* get(int size);
+
+private:
+    void build_loop();
+    bool has(int size) const;
+    const PieceSprites* nearest(int size) const;
+
+    const PieceSprites* base = nullptr;
+    std::function<void()> onReady;
+    std::vector<std::shared_ptr<const PieceSprites>> cached; // UI thread only
+
+    std::mutex mutex; // Guards the members below
+    std::vector<std::shared_ptr<const PieceSprites>> built; // Done, not yet in 'cached'
+    int wanted = 0;   // Next size to build, 0 if none
+    int building = 0; // Size the worker is building, 0 if none
+    bool running = false, stopping = false;
+    std::thread worker;
+};
+
+} // namespace ChessCore
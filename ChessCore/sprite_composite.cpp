@@ -0,0 +1,64 @@
+// sprite_composite.cpp: compositing kernel selection, scalar and 128-bit kernels
+
+#include "sprite_composite.h"
+
+#include <opencv2/core/utility.hpp>
+
+#include "sprite_composite_simd.h"
+
+namespace ChessCore {
+
+// In sprite_composite_avx2.cpp; nullptr when that unit was built without AVX2
+CompositeRowFn composite_row_avx2_kernel();
+
+namespace {
+
+void composite_row_scalar(uchar* dst, const uchar* src, int width) {
+    composite_tail(dst, src, 0, width);
+}
+
+#if CV_SIMD128
+void composite_row_simd128(uchar* dst, const uchar* src, int width) {
+    int x = composite_simd<cv::v_uint8x16, cv::v_uint16x8>(dst, src, 0, width);
+    composite_tail(dst, src, x, width);
+}
+#endif
+
+} // namespace
+
+CompositeRowFn composite_kernel(CompositeKernel kernel) {
+    switch (kernel) {
+    case COMPOSITE_SCALAR:
+        return composite_row_scalar;
+#if CV_SIMD128
+    case COMPOSITE_SIMD128:
+        return composite_row_simd128;
+#endif
+    case COMPOSITE_AVX2:
+        return cv::checkHardwareSupport(CV_CPU_AVX2) ? composite_row_avx2_kernel() : nullptr;
+    default:
+        return nullptr;
+    }
+}
+
+CompositeKernel best_composite_kernel() {
+    static const CompositeKernel best = [] {
+        for (int k = COMPOSITE_KERNEL_NB - 1; k > COMPOSITE_SCALAR; --k)
+            if (composite_kernel(CompositeKernel(k)))
+                return CompositeKernel(k);
+        return COMPOSITE_SCALAR;
+    }();
+    return best;
+}
+
+const char* composite_kernel_name(CompositeKernel kernel) {
+    static const char* Names[COMPOSITE_KERNEL_NB] = { "scalar", "simd128", "avx2" };
+    return kernel < COMPOSITE_KERNEL_NB ? Names[kernel] : "";
+}
+
+void composite_row(uchar* dst, const uchar* src, int width) {
+    static const CompositeRowFn row = composite_kernel(best_composite_kernel());
+    row(dst, src, width);
+}
+
+} // namespace ChessCore
@@ -0,0 +1,51 @@
+// sprite_composite.h: the row kernel that blends piece sprites onto the board.
+// Sprites are premultiplied BGRA, the board is BGR, and each pixel becomes
+// dst = src + dst * (255 - alpha) / 255, rounded. Partial alpha is kept, so
+// antialiased edges blend smoothly instead of being cut by a binary mask.
+//
+// The kernel is written once with OpenCV's universal intrinsics
+// (opencv2/core/hal/intrin.hpp) and built at two widths: 128-bit (SSE2 on
+// x86, NEON on ARM) in the baseline translation unit, and 256-bit in
+// sprite_composite_avx2.cpp, which alone is compiled with AVX2 enabled. The
+// widest kernel the CPU supports is picked on first use; the scalar loop
+// handles row tails and machines without SIMD. All kernels give identical
+// results.
+
+#pragma once
+
+#include <opencv2/core/hal/interface.h>
+
+namespace ChessCore {
+
+namespace {
+
+// x / 255 rounded, exact for x <= 255 * 255: the one rounding rule for
+// premultiplying sprites and for every compositing kernel. Internal linkage
+// because the AVX2 unit includes this header too.
+constexpr int div255(int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+} // namespace
+
+enum CompositeKernel {
+    COMPOSITE_SCALAR,
+    COMPOSITE_SIMD128,
+    COMPOSITE_AVX2,
+    COMPOSITE_KERNEL_NB
+};
+
+// One row: 'width' premultiplied BGRA pixels from src over BGR pixels in dst
+using CompositeRowFn = void (*)(uchar* dst, const uchar* src, int width);
+
+// Composites one row with the best kernel for this CPU
+void composite_row(uchar* dst, const uchar* src, int width);
+
+// A specific kernel, or nullptr if it was not built or the CPU lacks it
+CompositeRowFn composite_kernel(CompositeKernel kernel);
+// The kernel composite_row uses
+CompositeKernel best_composite_kernel();
+const char* composite_kernel_name(CompositeKernel kernel);
+
+} // namespace ChessCore
@@ -0,0 +1,44 @@
+// sprite_composite_avx2.cpp: the 256-bit compositing kernel.
+// This unit alone is compiled with AVX2 enabled (-mavx2, /arch:AVX2) and is
+// only called after the CPU was checked. Outside OpenCV's own build its
+// headers turn on nothing beyond SSE2 by themselves, so the 256-bit
+// intrinsics are enabled here; CV_CPU_DISPATCH_MODE moves them into their
+// own namespace (cv::hal_AVX2) so no inline OpenCV function compiled for
+// AVX2 is shared with the baseline code.
+
+#if defined(__AVX2__)
+#define CV_CPU_DISPATCH_MODE AVX2
+#include <immintrin.h>
+#define CV_AVX 1
+#define CV_AVX2 1
+#endif
+
+#include "sprite_composite.h"
+
+#include "sprite_composite_simd.h"
+
+namespace ChessCore {
+
+#if CV_SIMD256
+namespace {
+
+void composite_row_avx2(uchar* dst, const uchar* src, int width) {
+    int x = composite_simd<cv::v_uint8x32, cv::v_uint16x16>(dst, src, 0, width);
+    // A 50-pixel row is 32 + 16 + 2
+    x = composite_simd<cv::v_uint8x16, cv::v_uint16x8>(dst, src, x, width);
+    cv::v256_cleanup();
+    composite_tail(dst, src, x, width);
+}
+
+} // namespace
+
+CompositeRowFn composite_row_avx2_kernel() {
+    return composite_row_avx2;
+}
+#else
+CompositeRowFn composite_row_avx2_kernel() {
+    return nullptr;
+}
+#endif
+
+} // namespace ChessCore
@@ -0,0 +1,79 @@
+// sprite_composite_simd.h: body of the compositing kernels, shared by the
+// translation units that build it at different vector widths. Include it
+// after opencv2/core/hal/intrin.hpp; everything here has internal linkage,
+// so code compiled for AVX2 can never be picked up by the baseline unit.
+
+#pragma once
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "sprite_composite.h"
+
+namespace ChessCore {
+
+namespace {
+
+// Scalar pixels [x, width)
+inline void composite_tail(uchar* dst, const uchar* src, int x, int width) {
+    for (dst += 3 * x, src += 4 * x; x < width; ++x, dst += 3, src += 4) {
+        int inv = 255 - src[3];
+        if (inv == 255)
+            continue;
+        dst[0] = uchar(src[0] + div255(dst[0] * inv));
+        dst[1] = uchar(src[1] + div255(dst[1] * inv));
+        dst[2] = uchar(src[2] + div255(dst[2] * inv));
+    }
+}
+
+// div255() on eight or sixteen 16-bit lanes, same rounding; every step stays
+// below 65536
+template <typename VU16>
+inline VU16 div255(const VU16& x, const VU16& half) {
+    VU16 t = cv::v_add(x, half);
+    return cv::v_shr<8>(cv::v_add(t, cv::v_shr<8>(t)));
+}
+
+// dst channel * inv / 255 for a whole vector of 8-bit lanes
+template <typename VU8, typename VU16>
+inline VU8 scale_channel(const VU8& d, const VU16& invLo, const VU16& invHi, const VU16& half) {
+    VU16 lo, hi;
+    cv::v_expand(d, lo, hi);
+    return cv::v_pack(div255(cv::v_mul_wrap(lo, invLo), half), div255(cv::v_mul_wrap(hi, invHi), half));
+}
+
+// Pixels [x, width) at the width of VU8 (v_uint8x16 or v_uint8x32) while a
+// whole vector fits; returns where it stopped
+template <typename VU8, typename VU16>
+int composite_simd(uchar* dst, const uchar* src, int x, int width) {
+    const int lanes = VU8::nlanes;
+    const VU8 zero = cv::v_setall_<VU8>(uchar(0));
+    const VU8 full = cv::v_setall_<VU8>(uchar(255));
+    const VU16 half = cv::v_setall_<VU16>(ushort(128));
+
+    for (; x + lanes <= width; x += lanes) {
+        VU8 sb, sg, sr, sa;
+        cv::v_load_deinterleave(src + 4 * x, sb, sg, sr, sa);
+        // Sprite corners and margins are fully transparent
+        if (cv::v_check_all(cv::v_eq(sa, zero)))
+            continue;
+        uchar* d = dst + 3 * x;
+        if (cv::v_check_all(cv::v_eq(sa, full))) {
+            cv::v_store_interleave(d, sb, sg, sr);
+            continue;
+        }
+        VU8 db, dg, dr;
+        cv::v_load_deinterleave(d, db, dg, dr);
+        VU16 invLo, invHi;
+        cv::v_expand(cv::v_sub(full, sa), invLo, invHi);
+        // src <= alpha, so the sums stay within 255
+        db = cv::v_add(sb, scale_channel(db, invLo, invHi, half));
+        dg = cv::v_add(sg, scale_channel(dg, invLo, invHi, half));
+        dr = cv::v_add(sr, scale_channel(dr, invLo, invHi, half));
+        cv::v_store_interleave(d, db, dg, dr);
+    }
+    return x;
+}
+
+} // namespace
+
+} // namespace ChessCore
@@ -0,0 +1,84 @@
+// spsc_queue.h: bounded lock-free queue for one producer and one consumer.
+// Slots live inline in a power-of-two ring, so pushing and popping never
+// allocate. Records are built and read in place through write_slot()/
+// commit() and front()/pop(), so a large record is never copied through a
+// temporary. Head and tail sit on their own cache lines, and each side keeps
+// a cached copy of the other side's index so it only touches the shared line
+// when the ring looks full (producer) or empty (consumer).
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace ChessCore {
+
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Producer: the slot to fill next, or nullptr if the ring is full.
+    // The record becomes visible to the consumer on commit().
+    T* write_slot() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == Capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == Capacity)
+                return nullptr;
+        }
+        return &slots[t & (Capacity - 1)];
+    }
+    void commit() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    bool try_push(const T& value) {
+        T* slot = write_slot();
+        if (!slot)
+            return false;
+        *slot = value;
+        commit();
+        return true;
+    }
+
+    // Producer: slots that can be written without waiting
+    size_t free_slots() {
+        cachedHead = head.load(std::memory_order_acquire);
+        return Capacity - (tail.load(std::memory_order_relaxed) - cachedHead);
+    }
+
+    // Consumer: the oldest record, or nullptr if the ring is empty. It stays
+    // valid until pop().
+    const T* front() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail)
+                return nullptr;
+        }
+        return &slots[h & (Capacity - 1)];
+    }
+    void pop() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    bool try_pop(T& value) {
+        const T* slot = front();
+        if (!slot)
+            return false;
+        value = *slot;
+        pop();
+        return true;
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    // Indices count up forever; the slot is index & (Capacity - 1)
+    alignas(CACHE_LINE) std::atomic<size_t> head{ 0 }; // Written by the consumer
+    alignas(CACHE_LINE) size_t cachedTail = 0;         // Consumer's copy of tail
+    alignas(CACHE_LINE) std::atomic<size_t> tail{ 0 }; // Written by the producer
+    alignas(CACHE_LINE) size_t cachedHead = 0;         // Producer's copy of head
+    alignas(CACHE_LINE) T slots[Capacity];
+};
+
+} // namespace ChessCore
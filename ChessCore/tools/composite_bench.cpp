@@ -0,0 +1,147 @@
+// composite_bench.cpp: microbenchmark of the sprite compositing kernels,
+// laid out like OpenCV's imgproc perf tests: one test per (sprite size,
+// kernel) pair, a warm-up, then timed samples of one cycle each (one piece
+// composited onto its square) reported as median and minimum. Each kernel's
+// output is checked against the scalar kernel before it is timed.
+//
+// Usage: composite_bench [image dir] [-n samples]
+//   With an image dir the twelve piece sprites are used, e.g.
+//   composite_bench ../ChessAI/ChessAI/ -n 2000; without one, synthetic
+//   sprites (an antialiased disc on a transparent square).
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "board.h"
+#include "piece_sprites.h"
+#include "sprite_composite.h"
+
+using namespace ChessCore;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int Sizes[] = { 50, 100, 200 };
+
+// Premultiplied disc, opaque inside, fading out over its last two pixels
+cv::Mat synthetic_sprite(int size) {
+    cv::Mat sprite(size, size, CV_8UC4);
+    double centre = (size - 1) / 2.0, radius = size * 0.4;
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x) {
+            double d = std::hypot(x - centre, y - centre);
+            int a = int(std::lround(255 * std::min(1.0, std::max(0.0, (radius - d) / 2))));
+            cv::Vec4b& p = sprite.at<cv::Vec4b>(y, x);
+            p = cv::Vec4b(uchar(a * 40 / 255), uchar(a * 90 / 255), uchar(a), uchar(a));
+        }
+    return sprite;
+}
+
+void composite(CompositeRowFn row, cv::Mat& dst, const cv::Mat& sprite) {
+    for (int y = 0; y < sprite.rows; ++y)
+        row(dst.ptr<uchar>(y), sprite.ptr<uchar>(y), sprite.cols);
+}
+
+struct Stats {
+    double median, min;
+};
+
+// Times 'samples' cycles of compositing every sprite onto a fresh copy of
+// the background; the copy is not timed. Returns nanoseconds per sprite.
+Stats run(CompositeRowFn row, const std::vector<cv::Mat>& sprites, const cv::Mat& background, int samples) {
+    cv::Mat dst;
+    std::vector<double> ns;
+    ns.reserve(samples);
+    for (int i = -samples / 10; i < samples; ++i) { // Negative: warm-up
+        background.copyTo(dst);
+        Clock::time_point start = Clock::now();
+        for (const cv::Mat& sprite : sprites)
+            composite(row, dst, sprite);
+        double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (i >= 0)
+            ns.push_back(elapsed / sprites.size());
+    }
+    std::sort(ns.begin(), ns.end());
+    return { ns[ns.size() / 2], ns.front() };
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string dir;
+    int samples = 1000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc)
+            samples = std::max(10, std::atoi(argv[++i]));
+        else
+            dir = arg;
+    }
+    if (!dir.empty() && dir.back() != '/' && dir.back() != '\\')
+        dir += '/';
+
+    init();
+    PieceSprites pieces;
+    if (!dir.empty() && !pieces.load(dir, Sizes[0])) {
+        std::fprintf(stderr, "missing piece images in %s\n", dir.c_str());
+        return 1;
+    }
+
+    std::printf("kernels: ");
+    for (int k = 0; k < COMPOSITE_KERNEL_NB; ++k)
+        std::printf("%s%s", composite_kernel_name(CompositeKernel(k)),
+                    composite_kernel(CompositeKernel(k)) ? " " : " (unavailable) ");
+    std::printf("\ncomposite_row uses %s; %s sprites, %d samples per test\n\n",
+                composite_kernel_name(best_composite_kernel()), dir.empty() ? "synthetic" : "piece", samples);
+    std::printf("%-28s %12s %12s %10s\n", "Name of Test", "median ns", "min ns", "x scalar");
+
+    bool sane = true;
+    for (int size : Sizes) {
+        std::vector<cv::Mat> sprites;
+        if (dir.empty())
+            sprites.push_back(synthetic_sprite(size));
+        else {
+            pieces.set_size(size);
+            for (Piece pc : { W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
+                              B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING })
+                sprites.push_back(pieces.sprite(pc).clone());
+        }
+        cv::Mat background(size, size, CV_8UC3);
+        cv::randu(background, cv::Scalar::all(0), cv::Scalar::all(256));
+
+        // Sanity check: every kernel matches the scalar one byte for byte
+        cv::Mat expected = background.clone();
+        for (const cv::Mat& sprite : sprites)
+            composite(composite_kernel(COMPOSITE_SCALAR), expected, sprite);
+
+        double scalarMedian = 0;
+        for (int k = 0; k < COMPOSITE_KERNEL_NB; ++k) {
+            CompositeRowFn row = composite_kernel(CompositeKernel(k));
+            if (!row)
+                continue;
+            cv::Mat out = background.clone();
+            for (const cv::Mat& sprite : sprites)
+                composite(row, out, sprite);
+            if (cv::norm(out, expected, cv::NORM_INF) != 0) {
+                std::printf("%s: output differs from scalar at size %d\n", composite_kernel_name(CompositeKernel(k)), size);
+                sane = false;
+            }
+
+            Stats s = run(row, sprites, background, samples);
+            if (k == COMPOSITE_SCALAR)
+                scalarMedian = s.median;
+            char name[64];
+            std::snprintf(name, sizeof(name), "composite::%dx%d::%s", size, size, composite_kernel_name(CompositeKernel(k)));
+            std::printf("%-28s %12.0f %12.0f %10.2f\n", name, s.median, s.min, scalarMedian / s.median);
+        }
+    }
+    return sane ? 0 : 1;
+}
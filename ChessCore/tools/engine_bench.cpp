@@ -0,0 +1,120 @@
+// engine_bench.cpp: latency of EngineClient against a real UCI engine.
+// Measures the isready/readyok round trip, which is pure client and pipe
+// overhead, and optionally the time from a search command to its bestmove.
+//
+// Usage: engine_bench <engine> [-n rounds] [-g "go depth 10"]
+//   e.g. engine_bench ../ChessAI/ChessAI/stockfish/src/stockfish -g "go depth 12"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "engine_client.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Stats {
+    std::vector<double> samples; // microseconds
+
+    void print(const char* name) {
+        if (samples.empty())
+            return;
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for (double s : samples)
+            sum += s;
+        std::printf("%-10s n=%-5zu avg %10.1f us  min %10.1f us  median %10.1f us  max %10.1f us\n", name,
+                    samples.size(), sum / samples.size(), samples.front(), samples[samples.size() / 2], samples.back());
+    }
+};
+
+double micros(Clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string enginePath, goCmd;
+    int rounds = 1000;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc)
+            rounds = std::atoi(argv[++i]);
+        else if (arg == "-g" && i + 1 < argc)
+            goCmd = argv[++i];
+        else
+            enginePath = arg;
+    }
+    if (enginePath.empty()) {
+        std::fprintf(stderr, "usage: %s <engine> [-n rounds] [-g \"go ...\"]\n", argv[0]);
+        return 2;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool gotBestMove = false;
+    Clock::time_point bestMoveTime;
+    size_t infoLines = 0;
+
+    ChessCore::EngineClient::Handlers handlers;
+    handlers.onInfo = [&](std::string_view) { ++infoLines; };
+    handlers.onBestMove = [&](std::string_view) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bestMoveTime = Clock::now();
+        gotBestMove = true;
+        cv.notify_one();
+    };
+
+    ChessCore::EngineClient engine;
+    auto spawnStart = Clock::now();
+    if (!engine.start(enginePath, handlers)) {
+        std::fprintf(stderr, "cannot start %s\n", enginePath.c_str());
+        return 1;
+    }
+    engine.send("uci");
+    if (!engine.wait_ready()) {
+        std::fprintf(stderr, "engine did not answer isready\n");
+        return 1;
+    }
+    std::printf("startup    %10.1f us (spawn + uci + isready)\n", micros(Clock::now() - spawnStart));
+
+    Stats ready;
+    for (int i = 0; i < rounds; ++i) {
+        auto t0 = Clock::now();
+        if (!engine.wait_ready())
+            break;
+        ready.samples.push_back(micros(Clock::now() - t0));
+    }
+    ready.print("isready");
+
+    if (!goCmd.empty()) {
+        Stats go;
+        for (int i = 0; i < std::max(1, rounds / 100); ++i) {
+            engine.send("ucinewgame");
+            engine.send("position startpos");
+            engine.wait_ready();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            gotBestMove = false;
+            auto t0 = Clock::now();
+            engine.send(goCmd);
+            if (!cv.wait_for(lock, std::chrono::seconds(60), [&] { return gotBestMove; }))
+                break;
+            go.samples.push_back(micros(bestMoveTime - t0));
+        }
+        go.print("bestmove");
+        std::printf("info lines %zu\n", infoLines);
+    }
+
+    engine.stop();
+    return 0;
+}
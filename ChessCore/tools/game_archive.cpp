@@ -0,0 +1,144 @@
+// game_archive.cpp: reads and benchmarks the GUIs' game archive.
+//
+// Usage: game_archive <file> pgn [first [count]]   export games as PGN to stdout
+//        game_archive <file> stats                 results, plies and scan speed
+//        game_archive <file> bench <games>         append random games, then scan them
+//   e.g. game_archive ../ChessAI/ChessAI/ChessGames.bin pgn > games.pgn
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "board.h"
+#include "game_archive.h"
+#include "legal_moves.h"
+
+using namespace ChessCore;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Reads every game once; returns the number of plies read
+size_t scan(GameArchive& archive, size_t counts[4]) {
+    ArchivedGame game;
+    size_t plies = 0;
+    for (size_t i = 0; i < archive.size(); ++i) {
+        if (!archive.read(i, game)) {
+            std::fprintf(stderr, "cannot read game %zu\n", i);
+            break;
+        }
+        plies += game.moves.size();
+        ++counts[game.result];
+    }
+    return plies;
+}
+
+int stats(GameArchive& archive) {
+    size_t counts[4] = {};
+    Clock::time_point start = Clock::now();
+    size_t plies = scan(archive, counts);
+    double s = seconds_since(start);
+    std::printf("%zu games, %zu plies: %zu white wins, %zu black wins, %zu draws, %zu unfinished\n",
+                archive.size(), plies, counts[RESULT_WHITE_WINS], counts[RESULT_BLACK_WINS],
+                counts[RESULT_DRAW], counts[RESULT_UNFINISHED]);
+    std::printf("scan: %.3f s, %.0f games/s\n", s, archive.size() / (s > 0 ? s : 1e-9));
+    return 0;
+}
+
+// Random legal games with evals and clocks, as the GUIs would record them
+int bench(GameArchive& archive, size_t games) {
+    std::mt19937 rng(12345);
+    ArchivedGame game;
+    Board b;
+    size_t before = archive.size();
+
+    Clock::time_point start = Clock::now();
+    for (size_t g = 0; g < games; ++g) {
+        game.clear();
+        game.white = "Human";
+        game.black = "Stockfish";
+        game.startTime = int64_t(std::time(nullptr));
+        game.clockBaseMs = 300000;
+        game.clockIncMs = 2000;
+        b.set(StartFEN);
+        int clock[2] = { 300000, 300000 };
+        for (int ply = 0; ply < 160; ++ply) {
+            MoveList moves(b);
+            if (moves.empty()) {
+                game.result = !b.in_check() ? RESULT_DRAW
+                            : b.side_to_move() == WHITE ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+                break;
+            }
+            Move m = *(moves.begin() + rng() % moves.size());
+            Color us = b.side_to_move();
+            b.do_move(m);
+            clock[us] -= int(rng() % 5000);
+            game.moves.push_back(m);
+            game.evals.push_back(int16_t(int(rng() % 400) - 200));
+            game.clocksMs.push_back(clock[us]);
+        }
+        if (!archive.append(game)) {
+            std::fprintf(stderr, "append failed after %zu games\n", g);
+            return 1;
+        }
+    }
+    double appendSeconds = seconds_since(start);
+
+    size_t counts[4] = {};
+    start = Clock::now();
+    size_t plies = scan(archive, counts);
+    double scanSeconds = seconds_since(start);
+
+    std::printf("append: %zu games in %.3f s, %.0f games/s\n", games, appendSeconds,
+                games / (appendSeconds > 0 ? appendSeconds : 1e-9));
+    std::printf("scan:   %zu games (%zu before), %zu plies in %.3f s, %.0f games/s\n", archive.size(), before,
+                plies, scanSeconds, archive.size() / (scanSeconds > 0 ? scanSeconds : 1e-9));
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <file> pgn [first [count]] | stats | bench <games>\n", argv[0]);
+        return 2;
+    }
+    init();
+
+    GameArchive archive;
+    if (!archive.open(argv[1])) {
+        std::fprintf(stderr, "cannot open archive %s\n", argv[1]);
+        return 1;
+    }
+
+    std::string cmd = argv[2];
+    if (cmd == "pgn") {
+        size_t first = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 0;
+        size_t count = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : archive.size();
+        ArchivedGame game;
+        for (size_t i = first; i < archive.size() && i - first < count; ++i) {
+            if (!archive.read(i, game)) {
+                std::fprintf(stderr, "cannot read game %zu\n", i);
+                return 1;
+            }
+            write_pgn(std::cout, game, i + 1);
+        }
+        return 0;
+    }
+    if (cmd == "stats")
+        return stats(archive);
+    if (cmd == "bench" && argc > 3)
+        return bench(archive, std::strtoul(argv[3], nullptr, 10));
+
+    std::fprintf(stderr, "unknown command %s\n", cmd.c_str());
+    return 2;
+}
@@ -0,0 +1,183 @@
+// game_review.cpp: whole-game review with one or more UCI engines.
+// Reads a game as UCI moves from standard input, analyses every position
+// with GameReview's schedule (one contiguous block per engine, each walked
+// last-to-first so the hash table carries deeper results backwards) and
+// prints the eval, best move and classification of every move, followed by
+// the throughput in positions per second.
+//
+// Usage: game_review <engine> [-e engines] [-t threads per engine] [-d depth] [-h hash MB] < game.txt
+//   e.g. echo "e2e4 e7e5 g1f3 b8c6" | game_review ../ChessAI/ChessAI/stockfish/src/stockfish -e 2 -t 2
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine_client.h"
+#include "game_review.h"
+#include "search_info.h"
+
+using namespace ChessCore;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// One engine process analysing its share of the positions
+struct ReviewEngine {
+    EngineClient client;
+    std::mutex mutex;
+    std::condition_variable cv;
+    PositionEval last; // Latest main-line score of the running search
+    std::string bestMove;
+    bool gotBestMove = false;
+
+    bool start(const std::string& path, int threads, int hashMB) {
+        EngineClient::Handlers handlers;
+        handlers.onInfo = [this](std::string_view line) {
+            SearchInfo info;
+            if (!parse_info(line, info) || info.multiPV != 1)
+                return;
+            std::lock_guard<std::mutex> lock(mutex);
+            last.score = info.score;
+            last.isMate = info.isMate;
+            last.depth = info.depth;
+        };
+        handlers.onBestMove = [this](std::string_view line) {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t end = line.find(' ', 9);
+            bestMove = std::string(line.substr(9, end == std::string_view::npos ? end : end - 9));
+            gotBestMove = true;
+            cv.notify_one();
+        };
+        if (!client.start(path, handlers))
+            return false;
+        client.send("uci");
+        client.send("setoption name Threads value " + std::to_string(threads));
+        client.send("setoption name Hash value " + std::to_string(hashMB));
+        client.send("ucinewgame");
+        return client.wait_ready(30000);
+    }
+
+    // Searches the position after 'moves' and waits for the answer
+    bool analyse(const std::string& fen, const std::vector<Move>& moves, int depth, PositionEval& eval) {
+        std::string cmd = "position fen " + fen + " moves";
+        for (Move m : moves)
+            cmd += " " + Board::uci(m);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        last = PositionEval();
+        gotBestMove = false;
+        client.send(cmd);
+        client.send("go depth " + std::to_string(depth));
+        if (!cv.wait_for(lock, std::chrono::seconds(120), [&] { return gotBestMove; }))
+            return false;
+
+        Board b;
+        b.set(fen);
+        for (Move m : moves)
+            b.do_move(m);
+        eval = last;
+        eval.best = b.parse_uci(bestMove);
+        return true;
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string enginePath;
+    int engines = 1, depth = 14, hashMB = 64;
+    int threads = std::max(1, int(std::thread::hardware_concurrency()));
+    bool threadsSet = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-e" && i + 1 < argc)
+            engines = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "-t" && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+            threadsSet = true;
+        }
+        else if (arg == "-d" && i + 1 < argc)
+            depth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "-h" && i + 1 < argc)
+            hashMB = std::max(1, std::atoi(argv[++i]));
+        else
+            enginePath = arg;
+    }
+    if (enginePath.empty()) {
+        std::fprintf(stderr, "usage: %s <engine> [-e engines] [-t threads] [-d depth] [-h hash MB] < game.txt\n", argv[0]);
+        return 2;
+    }
+    // By default the cores are shared out between the engines
+    if (!threadsSet)
+        threads = std::max(1, threads / engines);
+
+    init();
+    Board b;
+    b.set(StartFEN);
+    std::vector<Move> moves;
+    for (std::string token; std::cin >> token; ) {
+        Move m = b.parse_uci(token);
+        if (!m) {
+            std::fprintf(stderr, "illegal move %s after %zu moves\n", token.c_str(), moves.size());
+            return 2;
+        }
+        b.do_move(m);
+        moves.push_back(m);
+    }
+
+    GameReview review;
+    review.reset(StartFEN, moves);
+
+    std::vector<ReviewEngine> pool(engines);
+    for (ReviewEngine& e : pool)
+        if (!e.start(enginePath, threads, hashMB)) {
+            std::fprintf(stderr, "cannot start %s\n", enginePath.c_str());
+            return 1;
+        }
+
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < engines; ++i)
+        workers.emplace_back([&, i] {
+            for (size_t ply : review.schedule(i, engines)) {
+                PositionEval eval;
+                if (pool[i].analyse(StartFEN, review.moves_to(ply), depth, eval))
+                    review.set_eval(ply, eval);
+            }
+        });
+    for (std::thread& t : workers)
+        t.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (!review.done()) {
+        std::fprintf(stderr, "some positions were not analysed\n");
+        return 1;
+    }
+
+    int counts[COLOR_NB][MQ_NB] = {};
+    std::vector<MoveReview> moveReviews = review.review();
+    for (size_t ply = 0; ply < moveReviews.size(); ++ply) {
+        const MoveReview& r = moveReviews[ply];
+        std::printf("%s\n", review.report_line(ply, r).c_str());
+        ++counts[r.side][r.quality];
+    }
+
+    for (Color c : { WHITE, BLACK })
+        std::printf("%s: %d inaccuracies, %d mistakes, %d blunders\n", c == WHITE ? "White" : "Black",
+                    counts[c][MQ_INACCURACY], counts[c][MQ_MISTAKE], counts[c][MQ_BLUNDER]);
+    std::printf("%zu positions, depth %d, %d engine(s) x %d thread(s): %.2f s, %.1f positions/s\n",
+                review.positions(), depth, engines, threads, seconds, review.positions() / seconds);
+
+    for (ReviewEngine& e : pool)
+        e.client.stop();
+    return 0;
+}
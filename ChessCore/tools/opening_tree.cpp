@@ -0,0 +1,224 @@
+// opening_tree.cpp: builds and queries the opening tree of a game archive.
+// The build streams the archive one game at a time and replays every game
+// to the ply limit; when built with Stockfish the positions are replayed with
+// Stockfish's Position::do_move and keyed by its Zobrist key, and the tool
+// checks that ChessCore's Board (which the GUI queries with) agrees.
+//
+// Usage: opening_tree build <archive> <tree> [-p max plies] [-m memory MB] [-t threads]
+//        opening_tree query <tree> [uci moves...]
+//        opening_tree bench <tree> <archive> [-p max plies]
+//   e.g. opening_tree build ChessGames.bin ChessOpenings.tree
+//        opening_tree query ChessOpenings.tree e2e4 c7c5
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "game_archive.h"
+#include "legal_moves.h"
+#include "opening_tree.h"
+
+#ifdef CHESSCORE_WITH_STOCKFISH
+#include "bitboard.h"
+#include "position.h"
+#include "uci.h"
+#endif
+
+using namespace ChessCore;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int build(const std::string& archivePath, const std::string& treePath, int maxPly, size_t memoryMB, int threads) {
+    GameArchive archive;
+    if (!archive.open(archivePath)) {
+        std::fprintf(stderr, "cannot open archive %s\n", archivePath.c_str());
+        return 1;
+    }
+
+    OpeningTreeBuilder builder;
+    OpeningTreeBuilder::Options options;
+    options.memoryMB = memoryMB;
+    options.threads = threads;
+    builder.begin(treePath, options);
+
+    Board board;
+    ArchivedGame game;
+    uint64_t illegal = 0, mismatches = 0;
+    Key keyCheck;
+#ifdef CHESSCORE_WITH_STOCKFISH
+    Stockfish::Position pos;
+    std::vector<Stockfish::StateInfo> states(size_t(maxPly) + 1); // Never reallocated: Position keeps pointers
+    pos.set(StartFEN, false, &states[0]);
+    keyCheck = pos.state()->key;
+#else
+    board.set(StartFEN);
+    keyCheck = board.key();
+#endif
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < archive.size(); ++i) {
+        if (!archive.read(i, game)) {
+            std::fprintf(stderr, "cannot read game %zu\n", i);
+            return 1;
+        }
+        std::string fen = game.fen.empty() ? StartFEN : game.fen;
+        board.set(fen);
+#ifdef CHESSCORE_WITH_STOCKFISH
+        pos.set(fen, false, &states[0]);
+#endif
+        builder.add_game();
+
+        size_t plies = std::min(game.moves.size(), size_t(maxPly));
+        for (size_t ply = 0; ply < plies; ++ply) {
+            Move m = game.moves[ply];
+            if (!MoveList(board).contains(m)) {
+                ++illegal;
+                break;
+            }
+            Key key = board.key();
+#ifdef CHESSCORE_WITH_STOCKFISH
+            if (pos.state()->key != key)
+                ++mismatches;
+            key = pos.state()->key;
+            pos.do_move(Stockfish::UCIEngine::to_move(pos, Board::uci(m)), states[ply + 1]);
+#endif
+            builder.add(key, m, game.result, ply < game.evals.size() ? game.evals[ply] : ArchivedGame::NO_EVAL);
+            board.do_move(m);
+        }
+    }
+    double readSeconds = seconds_since(start);
+
+    if (!builder.finish(keyCheck)) {
+        std::fprintf(stderr, "cannot write %s\n", treePath.c_str());
+        return 1;
+    }
+    double seconds = seconds_since(start);
+    const OpeningTreeBuilder::Stats& st = builder.stats();
+    std::printf("%llu games, %llu positions -> %llu entries, %llu runs; %.2f s (%.2f s replaying), %.0f positions/s\n",
+                (unsigned long long)st.games, (unsigned long long)st.samples, (unsigned long long)st.entries,
+                (unsigned long long)st.runs, seconds, readSeconds, st.samples / (seconds > 0 ? seconds : 1e-9));
+#ifdef CHESSCORE_WITH_STOCKFISH
+    std::printf("keys: Stockfish, %llu differing from ChessCore\n", (unsigned long long)mismatches);
+#else
+    (void)mismatches;
+    std::printf("keys: ChessCore (built without Stockfish)\n");
+#endif
+    if (illegal)
+        std::printf("%llu games stopped at an illegal move\n", (unsigned long long)illegal);
+    return 0;
+}
+
+int query(const std::string& treePath, const std::vector<std::string>& moves) {
+    OpeningTree tree;
+    if (!tree.open(treePath)) {
+        std::fprintf(stderr, "cannot open tree %s\n", treePath.c_str());
+        return 1;
+    }
+    Board board;
+    board.set(StartFEN);
+    for (const std::string& uci : moves) {
+        Move m = board.parse_uci(uci);
+        if (!m) {
+            std::fprintf(stderr, "illegal move %s\n", uci.c_str());
+            return 2;
+        }
+        board.do_move(m);
+    }
+
+    std::vector<OpeningTree::Entry> entries;
+    tree.lookup(board.key(), entries);
+    std::printf("%zu moves from this position (%llu games in the tree)\n", entries.size(), (unsigned long long)tree.games());
+    for (const OpeningTree::Entry& e : entries) {
+        unsigned finished = e.whiteWins + e.draws + e.blackWins;
+        char eval[16] = "-";
+        if (e.avgEval != ArchivedGame::NO_EVAL)
+            std::snprintf(eval, sizeof(eval), "%+.2f", e.avgEval / 100.0);
+        std::printf("%-6s %8u games  white %5.1f%%  draw %5.1f%%  black %5.1f%%  eval %s\n",
+                    Board::uci(Move(e.move)).c_str(), e.games,
+                    finished ? 100.0 * e.whiteWins / finished : 0.0, finished ? 100.0 * e.draws / finished : 0.0,
+                    finished ? 100.0 * e.blackWins / finished : 0.0, eval);
+    }
+    return 0;
+}
+
+// Looks up every archived position up to the ply limit, as the GUI does
+int bench(const std::string& treePath, const std::string& archivePath, int maxPly) {
+    OpeningTree tree;
+    GameArchive archive;
+    if (!tree.open(treePath) || !archive.open(archivePath)) {
+        std::fprintf(stderr, "cannot open %s or %s\n", treePath.c_str(), archivePath.c_str());
+        return 1;
+    }
+
+    std::vector<Key> keys;
+    Board board;
+    ArchivedGame game;
+    for (size_t i = 0; i < archive.size() && archive.read(i, game); ++i) {
+        board.set(game.fen.empty() ? StartFEN : game.fen);
+        for (size_t ply = 0; ply < std::min(game.moves.size(), size_t(maxPly)); ++ply) {
+            keys.push_back(board.key());
+            board.do_move(game.moves[ply]);
+        }
+    }
+
+    std::vector<OpeningTree::Entry> entries;
+    size_t found = 0;
+    Clock::time_point start = Clock::now();
+    for (Key k : keys) {
+        tree.lookup(k, entries);
+        found += !entries.empty();
+    }
+    double seconds = seconds_since(start);
+    std::printf("%zu lookups (%zu found) over %zu entries: %.3f s, %.0f lookups/s\n", keys.size(), found, tree.size(),
+                seconds, keys.size() / (seconds > 0 ? seconds : 1e-9));
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    int maxPly = 30, threads = 0;
+    size_t memoryMB = 256;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-p" && i + 1 < argc)
+            maxPly = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "-m" && i + 1 < argc)
+            memoryMB = size_t(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "-t" && i + 1 < argc)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else
+            args.push_back(arg);
+    }
+
+    ChessCore::init();
+#ifdef CHESSCORE_WITH_STOCKFISH
+    Stockfish::Bitboards::init();
+    Stockfish::Position::init();
+#endif
+
+    if (args.size() >= 3 && args[0] == "build")
+        return build(args[1], args[2], maxPly, memoryMB, threads);
+    if (args.size() >= 2 && args[0] == "query")
+        return query(args[1], std::vector<std::string>(args.begin() + 2, args.end()));
+    if (args.size() >= 3 && args[0] == "bench")
+        return bench(args[1], args[2], maxPly);
+
+    std::fprintf(stderr,
+                 "usage: %s build <archive> <tree> [-p max plies] [-m memory MB] [-t threads]\n"
+                 "       %s query <tree> [uci moves...]\n"
+                 "       %s bench <tree> <archive> [-p max plies]\n",
+                 argv[0], argv[0], argv[0]);
+    return 2;
+}
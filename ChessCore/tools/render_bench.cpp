@@ -0,0 +1,260 @@
+// render_bench.cpp: frame times of the board renderer, without a window.
+// Replays scripted games the way a player drives the GUI: for every ply one
+// frame with the moving piece selected and its targets shown, then one with
+// the move made. Each frame is rendered twice over: incrementally, as the
+// GUIs do, and fully (every square redrawn, as after a resize). Reports the
+// p50/p99/max frame time, the squares redrawn and the heap allocations per
+// frame, counting both operator new and OpenCV's Mat buffers.
+//
+// Usage: render_bench [image dir] [-s square size] [-n games] [-p max plies]
+//                     [-a archive] [-o last frame.png]
+//   e.g. render_bench ../ChessAI/ChessAI/ -s 100 -o board.png
+//   Without an image dir pieces are drawn as letters. The games are a few
+//   built-in openings plus random legal games (seeded), or the first -n
+//   games of a GUI game archive with -a.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "board.h"
+#include "board_renderer.h"
+#include "game_archive.h"
+#include "legal_moves.h"
+#include "piece_sprites.h"
+
+using namespace ChessCore;
+
+namespace {
+
+std::atomic<uint64_t> allocations{ 0 };
+
+using Clock = std::chrono::steady_clock;
+
+// Counts the Mat buffers, which do not go through operator new
+class CountingAllocator : public cv::MatAllocator {
+public:
+    explicit CountingAllocator(const cv::MatAllocator* std) : std(std) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        if (!data)
+            ++allocations;
+        return std->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override {
+        return std->allocate(data, accessFlags, usageFlags);
+    }
+    void deallocate(cv::UMatData* data) const override { std->deallocate(data); }
+
+private:
+    const cv::MatAllocator* std;
+};
+
+struct Game {
+    std::string fen; // Empty for the start position
+    std::vector<Move> moves;
+};
+
+const char* BuiltinGames[] = {
+    // Ruy Lopez, Morphy Defence, with both sides castling
+    "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6 b5a4 g8f6 e1g1 f8e7 f1e1 b7b5 a4b3 d7d6 c2c3 e8g8 h2h3 c6a5 b3c2 c7c5",
+    // Sicilian Najdorf, English Attack
+    "e2e4 c7c5 g1f3 d7d6 d2d4 c5d4 f3d4 g8f6 b1c3 a7a6 c1e3 e7e5 d4b3 c8e6 f2f3 f8e7 d1d2 e8g8 e1c1 b8d7",
+    // Queen's Gambit Declined, exchanges in the centre
+    "d2d4 d7d5 c2c4 e7e6 b1c3 g8f6 c1g5 f8e7 e2e3 e8g8 g1f3 h7h6 g5h4 b7b6 c4d5 f6d5 h4e7 d8e7 c3d5 e6d5",
+};
+
+std::vector<Game> builtin_games(int count, int maxPlies) {
+    std::vector<Game> games;
+    Board b;
+    for (const char* line : BuiltinGames) {
+        Game game;
+        b.set(StartFEN);
+        std::istringstream ss(line);
+        std::string uci;
+        while (ss >> uci && (int)game.moves.size() < maxPlies) {
+            Move m = b.parse_uci(uci);
+            if (m == Move::none())
+                break;
+            b.do_move(m);
+            game.moves.push_back(m);
+        }
+        games.push_back(std::move(game));
+    }
+    // Random legal games for the rest, promotions and all
+    std::mt19937 rng(12345);
+    while ((int)games.size() < count) {
+        Game game;
+        b.set(StartFEN);
+        for (int ply = 0; ply < maxPlies; ++ply) {
+            MoveList moves(b);
+            if (moves.empty())
+                break;
+            Move m = *(moves.begin() + rng() % moves.size());
+            b.do_move(m);
+            game.moves.push_back(m);
+        }
+        games.push_back(std::move(game));
+    }
+    games.resize(count);
+    return games;
+}
+
+bool archive_games(const std::string& path, int count, int maxPlies, std::vector<Game>& games) {
+    GameArchive archive;
+    if (!archive.open(path))
+        return false;
+    ArchivedGame archived;
+    for (size_t i = 0; i < archive.size() && (int)games.size() < count; ++i) {
+        if (!archive.read(i, archived))
+            return false;
+        Game game;
+        game.fen = archived.fen;
+        game.moves.assign(archived.moves.begin(),
+                          archived.moves.begin() + std::min<size_t>(archived.moves.size(), maxPlies));
+        games.push_back(std::move(game));
+    }
+    return true;
+}
+
+// Everything the GUI would show while the games are played
+std::vector<BoardFrame> script_frames(const std::vector<Game>& games) {
+    std::vector<BoardFrame> frames;
+    Board b;
+    for (const Game& game : games) {
+        b.set(game.fen.empty() ? StartFEN : game.fen);
+        frames.push_back(make_frame(b));
+        for (Move m : game.moves) {
+            BoardHighlights highlights;
+            highlights.selected = m.from_sq();
+            highlights.targets = MoveList(b).targets_from(m.from_sq());
+            frames.push_back(make_frame(b, highlights));
+            b.do_move(m);
+            frames.push_back(make_frame(b));
+        }
+    }
+    return frames;
+}
+
+struct Stats {
+    double p50, p99, max, mean; // Microseconds
+    double squares;             // Redrawn per frame
+    double allocs;              // Per frame
+};
+
+Stats run(BoardRenderer& renderer, const std::vector<BoardFrame>& frames, bool full) {
+    std::vector<double> us;
+    us.reserve(frames.size());
+    uint64_t squares = 0;
+
+    renderer.invalidate();
+    renderer.update(frames.front()); // Warm-up: the first update draws the background
+    uint64_t allocsBefore = allocations;
+    for (const BoardFrame& frame : frames) {
+        if (full)
+            renderer.invalidate();
+        Clock::time_point start = Clock::now();
+        Bitboard dirty = renderer.update(frame);
+        us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        squares += popcount(dirty);
+    }
+    uint64_t allocs = allocations - allocsBefore;
+
+    double sum = 0;
+    for (double t : us)
+        sum += t;
+    std::sort(us.begin(), us.end());
+    size_t n = us.size();
+    return { us[n / 2], us[std::min(n - 1, n * 99 / 100)], us.back(), sum / n,
+             double(squares) / n, double(allocs) / n };
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char* argv[]) {
+    std::string dir, archivePath, outPath;
+    int squareSize = 100, count = 20, maxPlies = 120;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-s" && i + 1 < argc)
+            squareSize = std::max(8, std::atoi(argv[++i]));
+        else if (arg == "-n" && i + 1 < argc)
+            count = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "-p" && i + 1 < argc)
+            maxPlies = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "-a" && i + 1 < argc)
+            archivePath = argv[++i];
+        else if (arg == "-o" && i + 1 < argc)
+            outPath = argv[++i];
+        else
+            dir = arg;
+    }
+    if (!dir.empty() && dir.back() != '/' && dir.back() != '\\')
+        dir += '/';
+
+    init();
+    PieceSprites sprites;
+    if (!dir.empty() && !sprites.load(dir, squareSize)) {
+        std::fprintf(stderr, "missing piece images in %s\n", dir.c_str());
+        return 1;
+    }
+
+    std::vector<Game> games;
+    if (archivePath.empty())
+        games = builtin_games(count, maxPlies);
+    else if (!archive_games(archivePath, count, maxPlies, games) || games.empty()) {
+        std::fprintf(stderr, "cannot read games from %s\n", archivePath.c_str());
+        return 1;
+    }
+    std::vector<BoardFrame> frames = script_frames(games);
+
+    CountingAllocator counting(cv::Mat::getStdAllocator());
+    cv::Mat::setDefaultAllocator(&counting);
+
+    BoardRenderer renderer;
+    renderer.reset(dir.empty() ? nullptr : &sprites, squareSize);
+    std::printf("%zu games, %zu frames, %dx%d board, %s\n\n", games.size(), frames.size(), 8 * squareSize,
+                8 * squareSize, dir.empty() ? "text pieces" : "piece sprites");
+    std::printf("%-12s %9s %9s %9s %9s %9s %12s\n", "mode", "p50 us", "p99 us", "max us", "mean us", "squares",
+                "allocs/frame");
+    for (bool full : { false, true }) {
+        Stats s = run(renderer, frames, full);
+        std::printf("%-12s %9.1f %9.1f %9.1f %9.1f %9.2f %12.2f\n", full ? "full" : "incremental", s.p50, s.p99,
+                    s.max, s.mean, s.squares, s.allocs);
+    }
+
+    cv::Mat::setDefaultAllocator(nullptr);
+    if (!outPath.empty()) {
+        if (!renderer.write_png(outPath)) {
+            std::fprintf(stderr, "cannot write %s\n", outPath.c_str());
+            return 1;
+        }
+        std::printf("\nlast frame written to %s\n", outPath.c_str());
+    }
+    return 0;
+}
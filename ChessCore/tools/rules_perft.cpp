@@ -0,0 +1,221 @@
+// rules_perft.cpp: perft over a FEN/EPD list with the GUI rules core.
+// Reports nodes and nodes/sec per position, checks the counts listed in the
+// EPD, and when built with Stockfish compares the per-move divide counts
+// against Stockfish::Benchmark::perft so that any disagreement about
+// castling, en passant or promotions shows up as the offending root move.
+//
+// Usage: rules_perft [-d depth] [-n] <file.epd | fen>
+//   Each line is a FEN, optionally followed by ";D<n> <nodes>" fields as in
+//   the usual perftsuite.epd. Without -d every listed depth is run, or depth
+//   4 if none is listed. -n skips the Stockfish comparison.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "legal_moves.h"
+
+#ifdef CHESSCORE_WITH_STOCKFISH
+#include "bitboard.h"
+#include "movegen.h"
+#include "perft.h"
+#include "position.h"
+#endif
+
+namespace {
+
+using Divide = std::map<std::string, uint64_t>;
+
+struct PerftCase {
+    std::string fen;
+    std::vector<std::pair<int, uint64_t>> expected; // (depth, nodes)
+};
+
+uint64_t perft(ChessCore::Board& board, int depth) {
+    ChessCore::MoveList moves(board);
+    if (depth == 1)
+        return uint64_t(moves.size());
+
+    uint64_t nodes = 0;
+    for (ChessCore::Move m : moves) {
+        board.do_move(m);
+        nodes += perft(board, depth - 1);
+        board.undo_move(m);
+    }
+    return nodes;
+}
+
+Divide divide(ChessCore::Board& board, int depth) {
+    Divide result;
+    for (ChessCore::Move m : ChessCore::MoveList(board)) {
+        board.do_move(m);
+        result[ChessCore::Board::uci(m)] = depth > 1 ? perft(board, depth - 1) : 1;
+        board.undo_move(m);
+    }
+    return result;
+}
+
+#ifdef CHESSCORE_WITH_STOCKFISH
+// Stockfish's own perft, split by root move. Benchmark::perft<false> does
+// not handle depth 1 itself, so that level is a plain move count.
+Divide stockfish_divide(const std::string& fen, int depth) {
+    using namespace Stockfish;
+
+    Divide result;
+    StateInfo rootSt;
+    Position pos;
+    pos.set(fen, false, &rootSt);
+
+    for (const auto& m : MoveList<LEGAL>(pos)) {
+        uint64_t cnt = 1;
+        if (depth > 1) {
+            StateInfo st;
+            pos.do_move(m, st);
+            cnt = depth == 2 ? MoveList<LEGAL>(pos).size() : Benchmark::perft<false>(pos, depth - 1);
+            pos.undo_move(m);
+        }
+        result[UCIEngine::move(m, false)] = cnt;
+    }
+    return result;
+}
+#endif
+
+// Prints the root moves whose counts differ. Returns true if none do.
+bool compare(const Divide& ours, const Divide& theirs) {
+    bool same = true;
+    auto report = [&](const std::string& move, const char* a, const char* b) {
+        std::printf("    %-6s ours %-12s stockfish %s\n", move.c_str(), a, b);
+        same = false;
+    };
+
+    for (const auto& [move, cnt] : ours) {
+        auto it = theirs.find(move);
+        if (it == theirs.end())
+            report(move, std::to_string(cnt).c_str(), "(illegal)");
+        else if (it->second != cnt)
+            report(move, std::to_string(cnt).c_str(), std::to_string(it->second).c_str());
+    }
+    for (const auto& [move, cnt] : theirs)
+        if (!ours.count(move))
+            report(move, "(missing)", std::to_string(cnt).c_str());
+    return same;
+}
+
+PerftCase parse_line(const std::string& line) {
+    PerftCase pc;
+    std::istringstream fields(line);
+    std::getline(fields, pc.fen, ';');
+    while (!pc.fen.empty() && (pc.fen.back() == ' ' || pc.fen.back() == '\r'))
+        pc.fen.pop_back();
+
+    for (std::string field; std::getline(fields, field, ';'); ) {
+        std::istringstream ss(field);
+        std::string tag;
+        uint64_t nodes;
+        if (ss >> tag >> nodes && tag.size() > 1 && tag[0] == 'D')
+            pc.expected.emplace_back(std::atoi(tag.c_str() + 1), nodes);
+    }
+    return pc;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int depthOverride = 0;
+    bool verify = true;
+    std::string input;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-d" && i + 1 < argc)
+            depthOverride = std::atoi(argv[++i]);
+        else if (arg == "-n")
+            verify = false;
+        else
+            input = arg;
+    }
+    if (input.empty()) {
+        std::fprintf(stderr, "usage: %s [-d depth] [-n] <file.epd | fen>\n", argv[0]);
+        return 2;
+    }
+
+    ChessCore::init();
+#ifdef CHESSCORE_WITH_STOCKFISH
+    Stockfish::Bitboards::init();
+    Stockfish::Position::init();
+#else
+    verify = false;
+#endif
+
+    std::vector<PerftCase> cases;
+    if (std::ifstream file(input); file) {
+        for (std::string line; std::getline(file, line); )
+            if (!line.empty() && line[0] != '#')
+                cases.push_back(parse_line(line));
+    }
+    else
+        cases.push_back(parse_line(input));
+
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+    int failures = 0;
+
+    for (size_t i = 0; i < cases.size(); ++i) {
+        PerftCase& pc = cases[i];
+        ChessCore::Board board;
+        if (!board.set(pc.fen)) {
+            std::printf("#%zu bad FEN: %s\n", i + 1, pc.fen.c_str());
+            ++failures;
+            continue;
+        }
+
+        std::vector<std::pair<int, uint64_t>> runs;
+        if (depthOverride)
+            runs.emplace_back(depthOverride, 0);
+        else if (pc.expected.empty())
+            runs.emplace_back(4, 0);
+        else
+            runs = pc.expected;
+
+        std::printf("#%zu %s\n", i + 1, pc.fen.c_str());
+        for (const auto& [depth, expected] : runs) {
+            if (depth < 1)
+                continue;
+
+            auto start = std::chrono::steady_clock::now();
+            Divide ours = divide(board, depth);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            uint64_t nodes = 0;
+            for (const auto& entry : ours)
+                nodes += entry.second;
+            totalNodes += nodes;
+            totalSeconds += seconds;
+
+            bool ok = !expected || nodes == expected;
+            std::printf("  depth %d  nodes %12llu  %8.3f s  %10.0f nps", depth,
+                        (unsigned long long)nodes, seconds, seconds > 0 ? nodes / seconds : 0.0);
+            if (expected)
+                std::printf("  %s", ok ? "ok" : "FAIL");
+            std::printf("\n");
+
+#ifdef CHESSCORE_WITH_STOCKFISH
+            if (verify && !compare(ours, stockfish_divide(pc.fen, depth)))
+                ok = false;
+#endif
+            failures += !ok;
+        }
+    }
+
+    std::printf("total nodes %llu  %.3f s  %.0f nps  %d failure(s)\n", (unsigned long long)totalNodes,
+                totalSeconds, totalSeconds > 0 ? totalNodes / totalSeconds : 0.0, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+// sprite_bench.cpp: cost of drawing the pieces of one frame.
+// Compares the old per-paint path (imread + resize(INTER_CUBIC) + split/merge
+// + masked copy for every piece on every paint) with the PieceSprites atlas
+// (decoded and scaled once, one premultiplied blend per piece), and times
+// rebuilding the atlas for a new square size.
+//
+// Usage: sprite_bench <image dir> [-s square size] [-n frames]
+//   e.g. sprite_bench ../ChessAI/ChessAI/ -s 100 -n 200
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "board.h"
+#include "piece_sprites.h"
+
+using namespace ChessCore;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// The pieces of the start position as (piece, square) pairs
+std::vector<std::pair<Piece, Square>> start_pieces() {
+    Board b;
+    b.set(StartFEN);
+    std::vector<std::pair<Piece, Square>> pieces;
+    for (int s = SQ_A1; s <= SQ_H8; ++s)
+        if (!b.empty(Square(s)))
+            pieces.emplace_back(b.piece_on(Square(s)), Square(s));
+    return pieces;
+}
+
+cv::Rect square_rect(Square s, int size) {
+    return cv::Rect(file_of(s) * size, (7 - rank_of(s)) * size, size, size);
+}
+
+// What createBoardImage used to do for every piece of every frame
+void draw_decoding(cv::Mat& board, const std::string& dir, Piece pc, const cv::Rect& r) {
+    cv::Mat image = cv::imread(dir + PieceSprites::file_name(pc), cv::IMREAD_UNCHANGED);
+    if (image.empty())
+        return;
+    cv::Mat scaled;
+    cv::resize(image, scaled, r.size(), 0, 0, cv::INTER_CUBIC);
+    cv::Mat roi = board(r);
+    if (scaled.channels() == 4) {
+        std::vector<cv::Mat> channels;
+        cv::split(scaled, channels);
+        cv::Mat rgb;
+        cv::merge(std::vector<cv::Mat>{ channels[0], channels[1], channels[2] }, rgb);
+        rgb.copyTo(roi, channels[3]);
+    }
+    else
+        scaled.copyTo(roi);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string dir;
+    int size = 100, frames = 100;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-s" && i + 1 < argc)
+            size = std::max(8, std::atoi(argv[++i]));
+        else if (arg == "-n" && i + 1 < argc)
+            frames = std::max(1, std::atoi(argv[++i]));
+        else
+            dir = arg;
+    }
+    if (dir.empty()) {
+        std::fprintf(stderr, "usage: %s <image dir> [-s square size] [-n frames]\n", argv[0]);
+        return 2;
+    }
+    if (dir.back() != '/' && dir.back() != '\\')
+        dir += '/';
+
+    init();
+    std::vector<std::pair<Piece, Square>> pieces = start_pieces();
+    cv::Mat board(8 * size, 8 * size, CV_8UC3, cv::Scalar(99, 136, 181));
+
+    Clock::time_point start = Clock::now();
+    PieceSprites sprites;
+    if (!sprites.load(dir, size)) {
+        std::fprintf(stderr, "missing piece images in %s\n", dir.c_str());
+        return 1;
+    }
+    double loadMs = ms_since(start);
+
+    int decodeFrames = std::max(1, frames / 10); // The old path is slow
+    start = Clock::now();
+    for (int f = 0; f < decodeFrames; ++f)
+        for (const auto& [pc, s] : pieces)
+            draw_decoding(board, dir, pc, square_rect(s, size));
+    double decodeMs = ms_since(start) / decodeFrames;
+
+    start = Clock::now();
+    for (int f = 0; f < frames; ++f)
+        for (const auto& [pc, s] : pieces)
+            sprites.draw(board, pc, square_rect(s, size));
+    double atlasMs = ms_since(start) / frames;
+
+    start = Clock::now();
+    sprites.set_size(size + 1);
+    sprites.set_size(size);
+    double resizeMs = ms_since(start) / 2;
+
+    std::printf("%zu pieces, %dx%d squares\n", pieces.size(), size, size);
+    std::printf("decode per paint: %8.3f ms/frame (%d frames)\n", decodeMs, decodeFrames);
+    std::printf("sprite atlas:     %8.3f ms/frame (%d frames), %.1fx faster\n", atlasMs, frames, decodeMs / atlasMs);
+    std::printf("atlas load %.1f ms, rebuild for a new size %.1f ms\n", loadMs, resizeMs);
+    return 0;
+}
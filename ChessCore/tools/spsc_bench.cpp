@@ -0,0 +1,207 @@
+// spsc_bench.cpp: throughput of SpscQueue and EngineEventQueue.
+// Runs a producer and a consumer thread, checks that every record arrives
+// once and in order, and counts heap allocations made while the threads
+// exchange records. A mutex-guarded std::deque runs the same exchange as a
+// baseline. Both sides yield instead of spinning when the queue is full or
+// empty, so the numbers stay meaningful on a single core.
+//
+// Usage: spsc_bench [-n records]
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include "engine_events.h"
+#include "spsc_queue.h"
+
+using namespace ChessCore;
+
+namespace {
+
+std::atomic<uint64_t> allocations{ 0 };
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double seconds;
+    uint64_t allocs;
+};
+
+// Starts producer and consumer, then times them from the moment both are
+// running; thread start-up allocations are not counted
+template<typename Producer, typename Consumer>
+Result run_pair(Producer produce, Consumer consume) {
+    std::atomic<int> ready{ 0 };
+    std::atomic<bool> go{ false };
+    auto wrap = [&](auto fn) {
+        return [&, fn]() mutable {
+            ++ready;
+            while (!go)
+                std::this_thread::yield();
+            fn();
+        };
+    };
+    std::thread consumer(wrap(consume));
+    std::thread producer(wrap(produce));
+    while (ready != 2)
+        std::this_thread::yield();
+
+    uint64_t allocsBefore = allocations;
+    Clock::time_point start = Clock::now();
+    go = true;
+    producer.join();
+    consumer.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return { seconds, allocations - allocsBefore };
+}
+
+void report(const char* name, uint64_t n, const Result& r, bool ok) {
+    std::printf("%-22s %12.1f M/s  %10.2f ns/record  allocations %-8llu %s\n", name, n / r.seconds / 1e6,
+                r.seconds * 1e9 / n, (unsigned long long)r.allocs, ok ? "ok" : "ORDER MISMATCH");
+}
+
+void bench_spsc(uint64_t n) {
+    static SpscQueue<uint64_t, 1024> queue;
+    bool ok = true;
+    Result r = run_pair(
+        [&] {
+            for (uint64_t i = 0; i < n; ++i)
+                while (!queue.try_push(i))
+                    std::this_thread::yield();
+        },
+        [&] {
+            uint64_t v;
+            for (uint64_t expected = 0; expected < n; ++expected) {
+                while (!queue.try_pop(v))
+                    std::this_thread::yield();
+                ok &= v == expected;
+            }
+        });
+    report("SpscQueue<uint64_t>", n, r, ok);
+}
+
+void bench_mutex_deque(uint64_t n) {
+    std::mutex mutex;
+    std::deque<uint64_t> queue;
+    bool ok = true;
+    Result r = run_pair(
+        [&] {
+            for (uint64_t i = 0; i < n; ++i) {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(i);
+            }
+        },
+        [&] {
+            for (uint64_t expected = 0; expected < n; ) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    while (!queue.empty()) {
+                        ok &= queue.front() == expected++;
+                        queue.pop_front();
+                    }
+                }
+                std::this_thread::yield();
+            }
+        });
+    report("mutex + deque", n, r, ok);
+}
+
+// An info flood with a bestmove every 'searchLength' reports, woken the way
+// ChessAI is: one wake-up per batch
+void bench_events(uint64_t n) {
+    constexpr uint64_t searchLength = 1000;
+    const char* line = "info depth 24 seldepth 33 multipv 1 score cp 31 wdl 62 903 35 nodes 2395431 nps 1203427 "
+                       "hashfull 412 tbhits 0 time 1990 pv e2e4 e7e5 g1f3 b8c6 f1b5 a7a6 b5a4 g8f6 e1g1 f8e7";
+
+    static EngineEventQueue queue;
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t wakes = 0;
+    bool pending = false;
+    queue.set_wake([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+        ++wakes;
+        cv.notify_one();
+    });
+
+    uint64_t received = 0, dropped = 0, bestMoves = n / searchLength;
+    double producerSeconds = 0;
+    bool ok = true;
+    Result r = run_pair(
+        [&] {
+            Clock::time_point start = Clock::now();
+            SearchInfo info;
+            EngineSession::SearchId id = 1;
+            for (uint64_t i = 1; i <= n; ++i) {
+                parse_info(line, info);
+                info.nodes = i;
+                dropped += !queue.push_info(id, info);
+                if (i % searchLength == 0)
+                    queue.push_best_move(id++, Move(SQ_E2, SQ_E4), Move(SQ_E7, SQ_E5));
+            }
+            producerSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        },
+        [&] {
+            EngineSession::SearchId id = 1;
+            uint64_t lastNodes = 0, movesSeen = 0;
+            while (movesSeen < bestMoves) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return pending; });
+                    pending = false;
+                }
+                queue.drain([&](const EngineEvent& e) {
+                    ++received;
+                    ok &= e.searchId == id;
+                    if (e.kind == EngineEvent::BEST_MOVE) {
+                        ++movesSeen;
+                        ++id;
+                        return;
+                    }
+                    ok &= e.info.info.nodes > lastNodes && e.info.pv().size() > 0;
+                    lastNodes = e.info.info.nodes;
+                });
+            }
+        });
+    report("EngineEventQueue", received, r, ok);
+    std::printf("%-22s %llu events in %llu wake-ups (%.1f per wake-up), %llu info reports dropped\n", "",
+                (unsigned long long)received, (unsigned long long)wakes, double(received) / (wakes ? wakes : 1),
+                (unsigned long long)dropped);
+    std::printf("%-22s engine side: %.1f ns per info line (parse + push)\n", "", producerSeconds * 1e9 / n);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t n = 10000000;
+    for (int i = 1; i < argc; ++i)
+        if (std::string_view(argv[i]) == "-n" && i + 1 < argc)
+            n = std::strtoull(argv[++i], nullptr, 10);
+
+    bench_spsc(n);
+    bench_mutex_deque(n);
+    bench_events(n / 10);
+    return 0;
+}
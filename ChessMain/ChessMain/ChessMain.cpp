@@ -1,62 +1,100 @@
 ﻿#include <windows.h>
 #include <tchar.h>
+#include <future>
 #include <string>
 
-// 헬퍼 함수: exe 전체 경로로부터 폴더만 추출
-std::wstring GetDirectoryFromPath(const std::wstring& exePath)
+#include "legal_moves.h"   // ChessCore::init
+#include "piece_sprites.h" // 두 모드가 함께 쓰는 기물 이미지
+
+// 두 모드는 같은 프로세스에 함께 빌드됨 (CHESSMAIN_HOST). 각 모드는 창 하나로 대국을
+// 진행하고 창이 닫히면 반환
+namespace TwoPlayerMode {
+int Run(HINSTANCE hInstance, int nCmdShow, const ChessCore::PieceSprites& sprites);
+}
+namespace VsAIMode {
+void StartEngineAsync();
+void ShutdownEngine();
+int Run(HINSTANCE hInstance, int nCmdShow, const ChessCore::PieceSprites& sprites);
+}
+
+#define BLOCK_SIZE 100 // 두 모드가 새 창에서 쓰는 칸 크기 (픽셀). 창 크기를 바꾸면 다른 크기는 각 모드가 워커 스레드에서 만듦
+
+// 이미지(png)와 stockfish 폴더가 있는 곳 (예전에 ChessAI.exe를 실행하던 작업 디렉터리).
+// 실행 파일 폴더에 있으면 그곳을, 없으면 빌드 출력 구조(ChessMain\x64\Release\ChessMain.exe)에서
+// ChessAI의 출력 폴더를 씀. 작업 디렉터리와는 무관하므로 바로 가기로 실행해도 같은 곳을 찾음
+#define ASSET_DIR_FROM_EXE L"..\\..\\..\\ChessAI\\x64\\Release"
+#define ASSET_MARKER L"King_white.png" // 이 파일이 있는 폴더를 에셋 폴더로 봄
+
+// 실행 파일이 있는 폴더. 알 수 없으면 빈 문자열
+std::wstring GetExeDirectory()
 {
+    wchar_t path[MAX_PATH];
+    DWORD len = GetModuleFileNameW(NULL, path, MAX_PATH);
+    if (len == 0 || len == MAX_PATH) return L""; // 실패 또는 경로가 잘림
+    std::wstring exePath(path, len);
     size_t pos = exePath.find_last_of(L"\\/");
-    if (pos != std::wstring::npos) {
-        return exePath.substr(0, pos);
-    }
-    return L".";
+    return pos != std::wstring::npos ? exePath.substr(0, pos) : L"";
 }
 
-int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE, LPTSTR, int nCmdShow)
+bool HasAssets(const std::wstring& dir)
 {
-    int ret = MessageBoxW(
-        NULL,
-        L"2인 모드로 시작하려면 '예', AI와 대결 모드로 시작하려면 '아니오'를 선택하세요.",
-        L"체스 모드 선택",
-        MB_YESNO | MB_ICONQUESTION
-    );
-
-    std::wstring exePath;
-    if (ret == IDYES) {
-        exePath = L"..\\..\\Chess2Player\\x64\\Release\\Chess2Player.exe";
-    }
-    else {
-        exePath = L"..\\..\\ChessAI\\x64\\Release\\ChessAI.exe";
+    return GetFileAttributesW((dir + L"\\" ASSET_MARKER).c_str()) != INVALID_FILE_ATTRIBUTES;
+}
+
+// 에셋 폴더를 작업 디렉터리로 설정. 찾지 못하면 false
+bool EnterAssetDirectory()
+{
+    std::wstring exeDir = GetExeDirectory();
+    if (exeDir.empty()) return false;
+    for (const std::wstring& dir : { exeDir, exeDir + L"\\" ASSET_DIR_FROM_EXE }) {
+        if (HasAssets(dir)) return SetCurrentDirectoryW(dir.c_str()) != FALSE;
     }
+    return false;
+}
 
-    // 작업 디렉터리(실행파일 폴더) 지정
-    std::wstring exeDir = GetDirectoryFromPath(exePath);
-
-    STARTUPINFOW si = { sizeof(si) };
-    PROCESS_INFORMATION pi = { 0 };
-
-    BOOL success = CreateProcessW(
-        exePath.c_str(),             // exe 절대/상대 경로
-        NULL,                        // 커맨드라인
-        NULL,                        // 프로세스 보안 속성
-        NULL,                        // 쓰레드 보안 속성
-        FALSE,                       // 핸들 상속
-        0,                           // 생성 플래그
-        NULL,                        // 환경 변수
-        exeDir.c_str(),              // 작업 디렉터리 (중요!)
-        &si,
-        &pi
-    );
-
-    if (!success) {
-        MessageBoxW(NULL, L"실행 파일을 찾을 수 없습니다.\nChess2Player.exe 또는 ChessAI.exe가 지정 위치에 있는지 확인하세요.", L"실행 오류", MB_OK | MB_ICONERROR);
+int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE, LPTSTR, int nCmdShow)
+{
+    ChessCore::init(); // 규칙 코어 공격 테이블 초기화
+    if (!EnterAssetDirectory()) {
+        MessageBoxW(NULL, L"기물 이미지와 엔진 파일이 있는 폴더를 찾을 수 없습니다.\nChessMain.exe와 같은 폴더나 "
+                          L"ChessAI\\x64\\Release 폴더에 png 파일과 stockfish 폴더가 있는지 확인하세요.",
+                    L"실행 오류", MB_OK | MB_ICONERROR);
         return 1;
     }
 
-    WaitForSingleObject(pi.hProcess, INFINITE);
+    // 사용자가 모드를 고르는 동안 기물 이미지 디코딩과 엔진 시작(신경망 로드)을 백그라운드에서 진행.
+    // 엔진은 한 번만 시작해 이후 AI 대국에서 계속 재사용
+    ChessCore::PieceSprites sprites;
+    std::future<bool> spritesLoaded = std::async(std::launch::async, [&sprites] { return sprites.load("", BLOCK_SIZE); });
+    VsAIMode::StartEngineAsync();
 
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
+    for (;;)
+    {
+        int ret = MessageBoxW(
+            NULL,
+            L"2인 모드로 시작하려면 '예', AI와 대결 모드로 시작하려면 '아니오'를 선택하세요.\n종료하려면 '취소'를 선택하세요.",
+            L"체스 모드 선택",
+            MB_YESNOCANCEL | MB_ICONQUESTION
+        );
+        if (ret != IDYES && ret != IDNO) {
+            break;
+        }
 
+        if (spritesLoaded.valid() && !spritesLoaded.get()) {
+            MessageBoxW(NULL, L"기물 이미지를 일부 찾을 수 없습니다. png 파일이 실행 폴더에 있는지 확인하세요.", L"이미지 오류", MB_OK | MB_ICONWARNING);
+        }
+
+        if (ret == IDYES) {
+            TwoPlayerMode::Run(hInstance, nCmdShow, sprites);
+        }
+        else {
+            VsAIMode::Run(hInstance, nCmdShow, sprites);
+        }
+    }
+
+    if (spritesLoaded.valid()) {
+        spritesLoaded.wait();
+    }
+    VsAIMode::ShutdownEngine();
     return 0;
 }